@@ -0,0 +1,248 @@
+#include "chunk_buffer.h"
+
+#include <algorithm>
+#include <cstring>
+
+ChunkPool::ChunkPool(size_t chunks_per_slab)
+    : chunks_per_slab_(chunks_per_slab == 0 ? 1 : chunks_per_slab),
+      free_list_(nullptr), total_chunks_(0), free_chunks_(0) {
+}
+
+ChunkPool::~ChunkPool() {
+    for (Chunk* slab : slabs_) {
+        delete[] slab;
+    }
+}
+
+void ChunkPool::grow() {
+    Chunk* slab = new Chunk[chunks_per_slab_];
+    slabs_.push_back(slab);
+
+    // 新slab中的数据块全部挂到空闲链表上
+    for (size_t i = 0; i < chunks_per_slab_; i++) {
+        slab[i].next = free_list_;
+        free_list_ = &slab[i];
+    }
+    total_chunks_ += chunks_per_slab_;
+    free_chunks_ += chunks_per_slab_;
+}
+
+ChunkPool::Chunk* ChunkPool::acquire() {
+    if (free_list_ == nullptr) {
+        grow();
+    }
+
+    Chunk* chunk = free_list_;
+    free_list_ = chunk->next;
+    free_chunks_--;
+
+    chunk->next = nullptr;
+    chunk->read_pos = 0;
+    chunk->write_pos = 0;
+    return chunk;
+}
+
+void ChunkPool::release(Chunk* chunk) {
+    chunk->next = free_list_;
+    free_list_ = chunk;
+    free_chunks_++;
+}
+
+ChunkBuffer::ChunkBuffer(ChunkPool& pool, size_t high_water_mark)
+    : pool_(pool), head_(nullptr), tail_(nullptr), reserved_(nullptr), size_(0),
+      high_water_mark_(high_water_mark) {
+}
+
+ChunkBuffer::~ChunkBuffer() {
+    clear();
+}
+
+void ChunkBuffer::append(const char* data, size_t len) {
+    while (len > 0) {
+        // 尾块写满或者还没有数据块时，从内存池取一个新块
+        if (tail_ == nullptr || tail_->write_pos == ChunkPool::CHUNK_SIZE) {
+            ChunkPool::Chunk* chunk = pool_.acquire();
+            if (tail_) {
+                tail_->next = chunk;
+            } else {
+                head_ = chunk;
+            }
+            tail_ = chunk;
+        }
+
+        size_t n = std::min(len, ChunkPool::CHUNK_SIZE - tail_->write_pos);
+        memcpy(tail_->data + tail_->write_pos, data, n);
+        tail_->write_pos += n;
+        size_ += n;
+        data += n;
+        len -= n;
+    }
+}
+
+int ChunkBuffer::prepare_iovec(struct iovec* iov, int max_iov) {
+    int count = 0;
+
+    // 先用尾块剩余的空间
+    if (tail_ && tail_->write_pos < ChunkPool::CHUNK_SIZE && count < max_iov) {
+        iov[count].iov_base = tail_->data + tail_->write_pos;
+        iov[count].iov_len = ChunkPool::CHUNK_SIZE - tail_->write_pos;
+        count++;
+    }
+
+    // 再从内存池预留新块
+    ChunkPool::Chunk** link = &reserved_;
+    while (*link) {
+        link = &(*link)->next;
+    }
+    while (count < max_iov) {
+        ChunkPool::Chunk* chunk = pool_.acquire();
+        *link = chunk;
+        link = &chunk->next;
+        iov[count].iov_base = chunk->data;
+        iov[count].iov_len = ChunkPool::CHUNK_SIZE;
+        count++;
+    }
+    return count;
+}
+
+void ChunkBuffer::commit(size_t len) {
+    if (tail_ && tail_->write_pos < ChunkPool::CHUNK_SIZE) {
+        size_t n = std::min(len, ChunkPool::CHUNK_SIZE - tail_->write_pos);
+        tail_->write_pos += n;
+        size_ += n;
+        len -= n;
+    }
+
+    // 已写入数据的预留块依次挂到链表尾部
+    while (len > 0 && reserved_) {
+        ChunkPool::Chunk* chunk = reserved_;
+        reserved_ = chunk->next;
+        chunk->next = nullptr;
+
+        size_t n = std::min(len, ChunkPool::CHUNK_SIZE);
+        chunk->write_pos = n;
+        size_ += n;
+        len -= n;
+
+        if (tail_) {
+            tail_->next = chunk;
+        } else {
+            head_ = chunk;
+        }
+        tail_ = chunk;
+    }
+
+    // 没用到的预留块还给内存池
+    while (reserved_) {
+        ChunkPool::Chunk* next = reserved_->next;
+        pool_.release(reserved_);
+        reserved_ = next;
+    }
+}
+
+void ChunkBuffer::splice_from(ChunkBuffer& other) {
+    if (other.head_ == nullptr) {
+        return;
+    }
+
+    if (tail_) {
+        tail_->next = other.head_;
+    } else {
+        head_ = other.head_;
+    }
+    tail_ = other.tail_;
+    size_ += other.size_;
+
+    other.head_ = nullptr;
+    other.tail_ = nullptr;
+    other.size_ = 0;
+}
+
+size_t ChunkBuffer::find(char c, size_t from) const {
+    size_t offset = 0;
+    for (ChunkPool::Chunk* chunk = head_; chunk; chunk = chunk->next) {
+        size_t n = chunk->write_pos - chunk->read_pos;
+        // 跳过已经查找过的数据块，逐块用memchr(glibc按SIMD实现)扫描
+        if (from >= offset + n) {
+            offset += n;
+            continue;
+        }
+        size_t skip = from > offset ? from - offset : 0;
+        const char* begin = chunk->data + chunk->read_pos;
+        const char* found = (const char*)memchr(begin + skip, c, n - skip);
+        if (found) {
+            return offset + (found - begin);
+        }
+        offset += n;
+    }
+    return npos;
+}
+
+void ChunkBuffer::copy_to(size_t offset, char* dst, size_t len) const {
+    for (ChunkPool::Chunk* chunk = head_; chunk && len > 0; chunk = chunk->next) {
+        size_t n = chunk->write_pos - chunk->read_pos;
+        if (offset >= n) {
+            offset -= n;
+            continue;
+        }
+        size_t copy = std::min(len, n - offset);
+        memcpy(dst, chunk->data + chunk->read_pos + offset, copy);
+        dst += copy;
+        len -= copy;
+        offset = 0;
+    }
+}
+
+void ChunkBuffer::consume(size_t len) {
+    len = std::min(len, size_);
+    size_ -= len;
+
+    while (len > 0) {
+        size_t n = std::min(len, head_->write_pos - head_->read_pos);
+        head_->read_pos += n;
+        len -= n;
+
+        // 头块读空，还给内存池
+        if (head_->read_pos == head_->write_pos) {
+            ChunkPool::Chunk* next = head_->next;
+            pool_.release(head_);
+            head_ = next;
+            if (head_ == nullptr) {
+                tail_ = nullptr;
+            }
+        }
+    }
+}
+
+void ChunkBuffer::clear() {
+    while (head_) {
+        ChunkPool::Chunk* next = head_->next;
+        pool_.release(head_);
+        head_ = next;
+    }
+    while (reserved_) {
+        ChunkPool::Chunk* next = reserved_->next;
+        pool_.release(reserved_);
+        reserved_ = next;
+    }
+    tail_ = nullptr;
+    size_ = 0;
+}
+
+const char* ChunkBuffer::front_data() const {
+    return head_ ? head_->data + head_->read_pos : nullptr;
+}
+
+size_t ChunkBuffer::front_size() const {
+    return head_ ? head_->write_pos - head_->read_pos : 0;
+}
+
+int ChunkBuffer::fill_iovec(struct iovec* iov, int max_iov) const {
+    int count = 0;
+    for (ChunkPool::Chunk* chunk = head_; chunk && count < max_iov; chunk = chunk->next) {
+        iov[count].iov_base = chunk->data + chunk->read_pos;
+        iov[count].iov_len = chunk->write_pos - chunk->read_pos;
+        count++;
+    }
+    return count;
+}
@@ -0,0 +1,103 @@
+#ifndef CHUNK_BUFFER_H
+#define CHUNK_BUFFER_H
+
+#include <sys/uio.h>
+
+#include <string>
+#include <vector>
+#include <cstddef>
+
+// 固定大小数据块的内存池
+// 按slab批量分配数据块，释放的数据块进入空闲链表复用，直到池销毁才归还给系统。
+// 同一个事件循环内的所有连接共享一个池，非线程安全。
+class ChunkPool {
+public:
+    static constexpr size_t CHUNK_SIZE = 4096;
+
+    struct Chunk {
+        Chunk* next;
+        size_t read_pos;    // 已消费到的位置
+        size_t write_pos;   // 已写入到的位置
+        char data[CHUNK_SIZE];
+    };
+
+    explicit ChunkPool(size_t chunks_per_slab = 64);
+    ~ChunkPool();
+
+    ChunkPool(const ChunkPool&) = delete;
+    ChunkPool& operator=(const ChunkPool&) = delete;
+
+    Chunk* acquire();
+    void release(Chunk* chunk);
+
+    size_t total_chunks() const { return total_chunks_; }
+    size_t free_chunks() const { return free_chunks_; }
+
+private:
+    void grow();
+
+    size_t chunks_per_slab_;
+    std::vector<Chunk*> slabs_;
+    Chunk* free_list_;
+    size_t total_chunks_;
+    size_t free_chunks_;
+};
+
+// 由内存池数据块组成的链式缓冲区
+// 追加写入尾块，消费时只移动头块的读位置，读空的数据块立即还给内存池，
+// 不需要像std::string::erase那样搬移剩余数据。
+class ChunkBuffer {
+public:
+    explicit ChunkBuffer(ChunkPool& pool, size_t high_water_mark = 0);
+    ~ChunkBuffer();
+
+    ChunkBuffer(const ChunkBuffer&) = delete;
+    ChunkBuffer& operator=(const ChunkBuffer&) = delete;
+
+    void append(const char* data, size_t len);
+    void append(const std::string& data) { append(data.data(), data.size()); }
+
+
+    // 为readv准备可写空间：尾块剩余空间加上若干新数据块，最多max_iov段，返回段数
+    int prepare_iovec(struct iovec* iov, int max_iov);
+    // readv读入len字节后提交，未用到的预留数据块还给内存池
+    void commit(size_t len);
+    
+    // 把other中的全部数据块移到本缓冲区尾部，不拷贝数据（两者必须来自同一个内存池）
+    void splice_from(ChunkBuffer& other);
+
+    // 从from开始查找字节c第一次出现的位置(相对可读数据开头)，找不到返回npos
+    static const size_t npos = (size_t)-1;
+    size_t find(char c, size_t from = 0) const;
+    // 把从offset开始的len字节复制到dst，不消费；调用者保证数据足够
+    void copy_to(size_t offset, char* dst, size_t len) const;
+
+    // 丢弃头部len字节
+    void consume(size_t len);
+    void clear();
+
+    size_t size() const { return size_; }
+    bool empty() const { return size_ == 0; }
+
+    // 头块中连续可读的数据
+    const char* front_data() const;
+    size_t front_size() const;
+
+    // 按顺序把数据块填入iovec数组（供writev使用），返回填入的个数
+    int fill_iovec(struct iovec* iov, int max_iov) const;
+
+    // 高水位线，0表示不限制
+    size_t high_water_mark() const { return high_water_mark_; }
+    void set_high_water_mark(size_t mark) { high_water_mark_ = mark; }
+    bool above_high_water() const { return high_water_mark_ != 0 && size_ >= high_water_mark_; }
+
+private:
+    ChunkPool& pool_;
+    ChunkPool::Chunk* head_;
+    ChunkPool::Chunk* tail_;
+    ChunkPool::Chunk* reserved_;    // prepare_iovec预留、尚未提交的数据块
+    size_t size_;
+    size_t high_water_mark_;
+};
+
+#endif // CHUNK_BUFFER_H
@@ -0,0 +1,36 @@
+#ifndef CO_ECHO_HANDLER_H
+#define CO_ECHO_HANDLER_H
+
+#include <string>
+#include <string_view>
+
+#include "coroutine.h"
+
+// 用协程写的Echo协议，行为与EchoHandler相同，作为CoroutineHandler的参考实现
+class CoEchoHandler : public CoroutineHandler<CoEchoHandler> {
+public:
+    explicit CoEchoHandler(const std::string& welcome_message = "")
+        : welcome_message_(welcome_message) {}
+
+    Task<> serve(CoConnection& io) {
+        if (!welcome_message_.empty()) {
+            co_await io.write(welcome_message_);
+        }
+        if (io.raw().codec.mode() == FrameMode::RAW) {
+            while (true) {
+                // 数据块整体移到发送缓冲区，不拷贝
+                ChunkBuffer& in = co_await io.read();
+                co_await io.write(in);
+            }
+        }
+        while (true) {
+            std::string_view frame = co_await io.read_frame();
+            co_await io.write_frame(frame);
+        }
+    }
+
+private:
+    std::string welcome_message_;
+};
+
+#endif // CO_ECHO_HANDLER_H
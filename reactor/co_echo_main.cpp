@@ -0,0 +1,56 @@
+#include "co_echo_handler.h"
+#include <csignal>
+
+// 协程版Echo服务器，单个事件循环，需要-std=c++20编译
+// 用法: ./co_echo [--host 地址] [--port 端口] [--frame raw|line|length]
+
+Reactor<EpollBackend, CoEchoHandler>* g_server = nullptr;
+
+// Reactor::shutdown只做原子操作和eventfd写入，可以直接在信号处理函数中调用
+void signal_handler(int signal) {
+    (void)signal;
+    if (g_server) {
+        g_server->shutdown(5000);
+    }
+}
+
+int main(int argc, char* argv[]) {
+    std::string host = "0.0.0.0";
+    int port = 8888;
+    ReactorOptions options;
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "--host") == 0 && i + 1 < argc) {
+            host = argv[++i];
+        } else if (strcmp(argv[i], "--port") == 0 && i + 1 < argc) {
+            port = atoi(argv[++i]);
+        } else if (strcmp(argv[i], "--frame") == 0 && i + 1 < argc) {
+            const char* mode = argv[++i];
+            if (strcmp(mode, "line") == 0) {
+                options.frame_mode = FrameMode::LINE;
+            } else if (strcmp(mode, "length") == 0) {
+                options.frame_mode = FrameMode::LENGTH_PREFIXED;
+            } else {
+                options.frame_mode = FrameMode::RAW;
+            }
+        }
+    }
+
+    try {
+        Reactor<EpollBackend, CoEchoHandler> server(host, port, options,
+                                                    CoEchoHandler("Welcome to Coroutine Echo Server!\n"));
+        g_server = &server;
+        signal(SIGINT, signal_handler);
+        signal(SIGTERM, signal_handler);
+        signal(SIGPIPE, SIG_IGN);
+
+        LOG_INFO("协程Echo服务器启动中... 按 Ctrl+C 停止服务器");
+        server.start();
+        g_server = nullptr;
+    } catch (const std::exception& e) {
+        LOG_ERROR("程序异常: " << e.what());
+        return 1;
+    }
+
+    LOG_INFO("程序正常退出");
+    return 0;
+}
@@ -0,0 +1,100 @@
+#ifndef COMPLETION_QUEUE_H
+#define COMPLETION_QUEUE_H
+
+#include <sys/eventfd.h>
+#include <poll.h>
+#include <sched.h>
+#include <unistd.h>
+#include <errno.h>
+
+#include <atomic>
+#include <cstdint>
+#include <cstring>
+#include <stdexcept>
+#include <string>
+
+// 工作线程向事件循环投递结果的队列：无锁多生产者单消费者链表 + eventfd唤醒
+// T必须有一个T* next成员，由队列使用。
+// 生产者用CAS把节点压到链表头，只有压入前队列为空时才写eventfd，
+// 一批结果只唤醒事件循环一次；消费者先清eventfd计数再一次取走整个链表并反转成先进先出顺序。
+// 节点压入之后事件循环就可能取走它并认为任务已经结束，而生产者还没写eventfd，
+// 所以用pushers_记录正在push的线程数，close()等它归零后才关闭eventfd，之后队列对象才能销毁。
+template <typename T>
+class CompletionQueue {
+public:
+    CompletionQueue() : head_(nullptr), event_fd_(-1), pushers_(0) {}
+    ~CompletionQueue() { close(); }
+
+    CompletionQueue(const CompletionQueue&) = delete;
+    CompletionQueue& operator=(const CompletionQueue&) = delete;
+
+    void open() {
+        event_fd_ = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+        if (event_fd_ == -1) {
+            throw std::runtime_error(std::string("eventfd failed: ") + strerror(errno));
+        }
+    }
+
+    // 事件循环线程调用，之后不能再有新的push；等正在进行的push全部写完eventfd再关闭
+    void close() {
+        while (pushers_.load(std::memory_order_acquire) > 0) {
+            sched_yield();
+        }
+        if (event_fd_ != -1) {
+            ::close(event_fd_);
+            event_fd_ = -1;
+        }
+    }
+
+    // 注册到事件循环后端的fd
+    int fd() const { return event_fd_; }
+
+    // 任意线程调用
+    void push(T* item) {
+        // 在节点可见之前计数，消费者取到节点时一定也能看到计数
+        pushers_.fetch_add(1, std::memory_order_seq_cst);
+        T* old_head = head_.load(std::memory_order_relaxed);
+        do {
+            item->next = old_head;
+        } while (!head_.compare_exchange_weak(old_head, item, std::memory_order_release,
+                                              std::memory_order_relaxed));
+        if (old_head == nullptr) {
+            uint64_t one = 1;
+            ssize_t n = write(event_fd_, &one, sizeof(one));
+            (void)n;
+        }
+        // 之后不能再访问队列，事件循环可能已经关闭并销毁它
+        pushers_.fetch_sub(1, std::memory_order_release);
+    }
+
+    // 事件循环线程调用：取走当前所有结果，按投递顺序返回链表头
+    T* pop_all() {
+        // 必须先清计数再取链表，否则取走之后、清计数之前投递的结果会丢掉唤醒
+        uint64_t count;
+        ssize_t n = read(event_fd_, &count, sizeof(count));
+        (void)n;
+
+        T* item = head_.exchange(nullptr, std::memory_order_acquire);
+        T* ordered = nullptr;
+        while (item) {
+            T* next = item->next;
+            item->next = ordered;
+            ordered = item;
+            item = next;
+        }
+        return ordered;
+    }
+
+    // 阻塞等待新结果，用于事件循环退出时等待尚未完成的任务
+    bool wait(int timeout_ms) {
+        pollfd pfd = {event_fd_, POLLIN, 0};
+        return poll(&pfd, 1, timeout_ms) == 1;
+    }
+
+private:
+    std::atomic<T*> head_;
+    int event_fd_;
+    std::atomic<int> pushers_;
+};
+
+#endif // COMPLETION_QUEUE_H
@@ -0,0 +1,57 @@
+#include "connection_table.h"
+
+#include <new>
+
+ConnectionTable::ConnectionTable(ChunkPool& pool, size_t connections_per_slab)
+    : pool_(pool), connections_per_slab_(connections_per_slab == 0 ? 1 : connections_per_slab), size_(0) {
+}
+
+ConnectionTable::~ConnectionTable() {
+    for (Slot& slot : slots_) {
+        if (slot.conn) {
+            slot.conn->~Connection();
+            slot.conn = nullptr;
+        }
+    }
+    for (Storage* slab : slabs_) {
+        delete[] slab;
+    }
+}
+
+void ConnectionTable::grow() {
+    Storage* slab = new Storage[connections_per_slab_];
+    slabs_.push_back(slab);
+    
+    // 倒序压栈，使得先分配的是slab开头的对象
+    for (size_t i = connections_per_slab_; i > 0; i--) {
+        free_list_.push_back(&slab[i - 1]);
+    }
+}
+
+Connection* ConnectionTable::create(int fd, const SocketAddress& addr, size_t high_water_mark) {
+    if ((size_t)fd >= slots_.size()) {
+        slots_.resize(fd + 1, Slot{nullptr, 0});
+    }
+    
+    if (free_list_.empty()) {
+        grow();
+    }
+    void* storage = free_list_.back();
+    free_list_.pop_back();
+    
+    // 代数从1开始，0留给监听socket
+    Slot& slot = slots_[fd];
+    slot.generation++;
+    slot.conn = new (storage) Connection(fd, slot.generation, addr, pool_, high_water_mark);
+    size_++;
+    return slot.conn;
+}
+
+void ConnectionTable::destroy(Connection* conn) {
+    Slot& slot = slots_[conn->fd];
+    slot.conn = nullptr;
+    
+    conn->~Connection();
+    free_list_.push_back(conn);
+    size_--;
+}
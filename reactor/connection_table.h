@@ -0,0 +1,104 @@
+#ifndef CONNECTION_TABLE_H
+#define CONNECTION_TABLE_H
+
+#include <netinet/in.h>
+
+#include <cstdint>
+#include <vector>
+#include <type_traits>
+
+#include "chunk_buffer.h"
+#include "frame_codec.h"
+#include "socket_utils.h"
+#include "timer_wheel.h"
+
+// 一个客户端连接的状态
+struct Connection {
+    int fd;
+    uint32_t generation;    // 所在fd槽位的代数，用于识别过期事件
+    SocketAddress addr;
+    ChunkBuffer recv_buffer;
+    ChunkBuffer send_buffer;
+    FrameCodec codec;   // 接收缓冲区的分帧状态，由事件循环按ReactorOptions设置
+    bool read_paused;   // 因发送缓冲区积压而暂停读取(已从后端去掉读事件)
+    bool write_armed;   // 是否已注册写事件
+    uint32_t registered_events; // 当前注册在后端的事件，与要注册的相同时不再调用modify
+    bool flush_queued;  // 是否已在本轮的flush_中
+    bool task_in_flight;    // 是否有请求正在工作线程池中处理，每个连接同时只有一个，保证回复顺序
+    bool half_closed;       // 平滑关闭时回复已发完并发出FIN，之后读到的数据直接丢弃，等对端关闭
+    int pipe_fds[2];    // splice直通用的管道，第一次需要时创建
+    size_t pipe_bytes;  // 已从socket移入管道、尚未发出的字节数
+
+    uint64_t last_active_ms;    // 最近一次收到或发出数据的时间
+    uint64_t last_write_ms;     // 最近一次发出数据或开始等待可写事件的时间
+    TimerWheel::TimerId idle_timer;
+    TimerWheel::TimerId stall_timer;
+    
+    Connection(int socket_fd, uint32_t gen, const SocketAddress& client_addr, ChunkPool& pool,
+               size_t high_water_mark)
+        : fd(socket_fd), generation(gen), addr(client_addr), recv_buffer(pool),
+          send_buffer(pool, high_water_mark), read_paused(false), write_armed(false),
+          registered_events(0), flush_queued(false), task_in_flight(false), half_closed(false), pipe_fds{-1, -1}, pipe_bytes(0),
+          last_active_ms(0), last_write_ms(0),
+          idle_timer(TimerWheel::INVALID_TIMER), stall_timer(TimerWheel::INVALID_TIMER) {}
+    
+    // 注册到后端的事件数据：高32位代数，低32位fd
+    uint64_t token() const { return ((uint64_t)generation << 32) | (uint32_t)fd; }
+};
+
+// 按fd下标索引的连接表
+// 查找是一次数组访问；Connection对象从按slab连续分配的对象池中构造，关闭后回到空闲链表。
+// 每个fd槽位带一个代数，连接关闭时加一，携带旧代数的事件会被find(token)拒绝。
+class ConnectionTable {
+public:
+    explicit ConnectionTable(ChunkPool& pool, size_t connections_per_slab = 256);
+    ~ConnectionTable();
+    
+    ConnectionTable(const ConnectionTable&) = delete;
+    ConnectionTable& operator=(const ConnectionTable&) = delete;
+    
+    Connection* create(int fd, const SocketAddress& addr, size_t high_water_mark);
+    void destroy(Connection* conn);
+    
+    Connection* find(int fd) const {
+        return (fd >= 0 && (size_t)fd < slots_.size()) ? slots_[fd].conn : nullptr;
+    }
+    
+    // 按事件数据查找，代数不匹配(连接已关闭或fd已被新连接复用)时返回nullptr
+    Connection* find_token(uint64_t token) const {
+        Connection* conn = find(token_fd(token));
+        return (conn && conn->generation == (uint32_t)(token >> 32)) ? conn : nullptr;
+    }
+    
+    static int token_fd(uint64_t token) { return (int)(uint32_t)token; }
+    
+    size_t size() const { return size_; }
+    
+    template <typename F>
+    void for_each(F f) {
+        for (Slot& slot : slots_) {
+            if (slot.conn) {
+                f(*slot.conn);
+            }
+        }
+    }
+
+private:
+    struct Slot {
+        Connection* conn;
+        uint32_t generation;
+    };
+    
+    typedef typename std::aligned_storage<sizeof(Connection), alignof(Connection)>::type Storage;
+    
+    void grow();
+    
+    ChunkPool& pool_;
+    std::vector<Slot> slots_;
+    size_t connections_per_slab_;
+    std::vector<Storage*> slabs_;
+    std::vector<void*> free_list_;
+    size_t size_;
+};
+
+#endif // CONNECTION_TABLE_H
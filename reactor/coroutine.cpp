@@ -0,0 +1,145 @@
+#include "coroutine.h"
+#include "logger.h"
+
+#include <new>
+
+thread_local FramePool* FramePool::current_ = nullptr;
+
+FramePool::~FramePool() {
+    for (size_t i = 0; i < CLASSES; i++) {
+        for (void* block : free_[i]) {
+            ::operator delete(block);
+        }
+    }
+}
+
+void* FramePool::allocate(size_t size) {
+    size_t index = (size + GRANULE - 1) / GRANULE;
+    if (index >= CLASSES) {
+        return ::operator new(size);
+    }
+    if (!free_[index].empty()) {
+        void* block = free_[index].back();
+        free_[index].pop_back();
+        return block;
+    }
+    blocks_++;
+    return ::operator new(index * GRANULE);
+}
+
+void FramePool::deallocate(void* ptr, size_t size) {
+    size_t index = (size + GRANULE - 1) / GRANULE;
+    if (index >= CLASSES) {
+        ::operator delete(ptr);
+        return;
+    }
+    free_[index].push_back(ptr);
+}
+
+void* FramePool::allocate_frame(size_t size) {
+    FramePool* pool = current_;
+    char* block = static_cast<char*>(pool ? pool->allocate(size + HEADER) : ::operator new(size + HEADER));
+    *reinterpret_cast<FramePool**>(block) = pool;
+    return block + HEADER;
+}
+
+void FramePool::free_frame(void* ptr, size_t size) {
+    // 帧总是在所属事件循环的线程中销毁，放回分配它的池
+    char* block = static_cast<char*>(ptr) - HEADER;
+    FramePool* pool = *reinterpret_cast<FramePool**>(block);
+    if (pool) {
+        pool->deallocate(block, size + HEADER);
+    } else {
+        ::operator delete(block);
+    }
+}
+
+CoConnection::CoConnection(Connection& conn, const CoroutineLoop& loop, FramePool& pool)
+    : conn_(conn), loop_(loop), pool_(pool), waiting_(WAIT_NONE),
+      timer_(TimerWheel::INVALID_TIMER), frame_pending_(false), finished_(false) {
+}
+
+CoConnection::~CoConnection() {
+    if (timer_ != TimerWheel::INVALID_TIMER) {
+        loop_.cancel_timer(loop_.loop, timer_);
+    }
+    // 挂起中的协程在这里销毁，帧放回池中
+    FramePool::Scope scope(pool_);
+    task_.reset();
+}
+
+void CoConnection::start(Task<> task) {
+    task_ = std::move(task);
+    waiter_ = task_.handle();
+    resume(false);
+}
+
+void CoConnection::on_input() {
+    if (waiting_ == WAIT_READ || (waiting_ == WAIT_FRAME && next_frame())) {
+        resume(false);
+    }
+}
+
+void CoConnection::on_drained() {
+    if (waiting_ == WAIT_DRAIN) {
+        resume(true);
+    }
+}
+
+void CoConnection::sleep(uint64_t delay_ms, std::coroutine_handle<> h) {
+    wait(WAIT_SLEEP, h);
+    timer_ = loop_.run_after(loop_.loop, delay_ms, [this]() {
+        timer_ = TimerWheel::INVALID_TIMER;
+        resume(true);
+    });
+}
+
+bool CoConnection::next_frame() {
+    if (frame_pending_) {
+        conn_.codec.pop(conn_.recv_buffer);
+        frame_pending_ = false;
+    }
+    if (conn_.codec.next(conn_.recv_buffer, frame_) != FrameCodec::FRAME) {
+        // 消息超长时codec进入失败状态，事件循环在on_message返回后关闭连接
+        return false;
+    }
+    frame_pending_ = true;
+    return true;
+}
+
+void CoConnection::resume(bool commit) {
+    std::coroutine_handle<> h = waiter_;
+    waiting_ = WAIT_NONE;
+    waiter_ = nullptr;
+
+    size_t queued_before = conn_.send_buffer.size();
+    {
+        FramePool::Scope scope(pool_);
+        h.resume();
+    }
+    if (commit) {
+        if (conn_.send_buffer.size() != queued_before) {
+            loop_.commit_send(loop_.loop, conn_, queued_before);
+        }
+        // on_message之外遇到超长消息，没有人检查codec，在这里关闭
+        if (conn_.codec.failed()) {
+            loop_.close_later(loop_.loop, conn_);
+            return;
+        }
+    }
+
+    if (task_.done() && !finished_) {
+        finished_ = true;
+        if (task_.handle().promise().exception) {
+            try {
+                std::rethrow_exception(task_.handle().promise().exception);
+            } catch (const std::exception& e) {
+                LOG_WARN("客户端 " << conn_.fd << " 的协程异常退出: " << e.what());
+            } catch (...) {
+                LOG_WARN("客户端 " << conn_.fd << " 的协程异常退出");
+            }
+        }
+        // 未消费的消息留在接收缓冲区，由on_message丢弃
+        loop_.close_later(loop_.loop, conn_);
+    }
+}
@@ -0,0 +1,387 @@
+#ifndef COROUTINE_H
+#define COROUTINE_H
+
+#if __cplusplus < 202002L
+#error "coroutine.h需要C++20 (-std=c++20)"
+#endif
+
+#include <coroutine>
+#include <cstddef>
+#include <cstdint>
+#include <exception>
+#include <optional>
+#include <string_view>
+#include <utility>
+#include <vector>
+
+#include "reactor.h"
+
+// 基于C++20协程的连接接口
+// 协议逻辑写成顺序代码，由Reactor的事件驱动，不需要每个连接一个线程：
+//
+//   Task<> serve(CoConnection& io) {
+//       while (true) {
+//           std::string_view frame = co_await io.read_frame();
+//           co_await io.write_frame(frame);
+//       }
+//   }
+//
+// 所有协程都在所属事件循环的线程中运行。连接关闭(对端断开、超时、错误)时，
+// 挂起中的协程直接被销毁，局部对象正常析构，co_await不会返回。
+
+// 协程帧内存池，每个事件循环一个
+// 协程在哪个池里分配取决于当时的FramePool::current()：处理器恢复协程前把它设为自己的池，
+// 协程里再调用的子协程也落在同一个池中。每块内存前面记录所属的池，释放时放回原处。
+// 同一个协程函数的帧大小固定，按64字节分级的空闲链表基本只用到一两级，分配和释放都是一次数组操作。
+class FramePool {
+public:
+    FramePool() : blocks_(0) {}
+    // 处理器在构造事件循环时被复制，复制得到的是一个新的空池
+    FramePool(const FramePool&) : FramePool() {}
+    FramePool& operator=(const FramePool&) = delete;
+    ~FramePool();
+
+    void* allocate(size_t size);
+    void deallocate(void* ptr, size_t size);
+
+    // 已从系统分配的内存块数(包括空闲链表中的)
+    size_t blocks() const { return blocks_; }
+
+    // 协程帧的分配入口，没有当前池时直接用全局的operator new
+    static void* allocate_frame(size_t size);
+    static void free_frame(void* ptr, size_t size);
+
+    static FramePool* current() { return current_; }
+
+    // 在作用域内把pool设为当前池
+    class Scope {
+    public:
+        explicit Scope(FramePool& pool) : saved_(current_) { current_ = &pool; }
+        ~Scope() { current_ = saved_; }
+        Scope(const Scope&) = delete;
+        Scope& operator=(const Scope&) = delete;
+
+    private:
+        FramePool* saved_;
+    };
+
+private:
+    static const size_t GRANULE = 64;
+    static const size_t CLASSES = 32;       // 2KB以上的帧不缓存
+    // 记录所属池的块头，保持帧的对齐
+    static const size_t HEADER = __STDCPP_DEFAULT_NEW_ALIGNMENT__;
+
+    std::vector<void*> free_[CLASSES];
+    size_t blocks_;
+
+    static thread_local FramePool* current_;
+};
+
+template <typename T = void>
+class Task;
+
+namespace detail {
+
+struct TaskPromiseBase {
+    std::coroutine_handle<> continuation;
+    std::exception_ptr exception;
+
+    static void* operator new(size_t size) { return FramePool::allocate_frame(size); }
+    static void operator delete(void* ptr, size_t size) { FramePool::free_frame(ptr, size); }
+
+    // 惰性启动：被co_await或被处理器恢复时才开始执行
+    std::suspend_always initial_suspend() noexcept { return {}; }
+
+    // 结束时直接切回等待它的协程(对称转移)，不增加调用栈深度；顶层协程停在这里，由所有者销毁
+    struct FinalAwaiter {
+        bool await_ready() noexcept { return false; }
+        template <typename Promise>
+        std::coroutine_handle<> await_suspend(std::coroutine_handle<Promise> h) noexcept {
+            std::coroutine_handle<> next = h.promise().continuation;
+            return next ? next : std::noop_coroutine();
+        }
+        void await_resume() noexcept {}
+    };
+    FinalAwaiter final_suspend() noexcept { return {}; }
+
+    void unhandled_exception() { exception = std::current_exception(); }
+};
+
+// 保存协程结果；Task<void>没有结果
+template <typename T>
+struct TaskPromise : TaskPromiseBase {
+    std::optional<T> value;
+
+    Task<T> get_return_object();
+    template <typename U>
+    void return_value(U&& v) { value.emplace(std::forward<U>(v)); }
+
+    T result() {
+        if (exception) {
+            std::rethrow_exception(exception);
+        }
+        return std::move(*value);
+    }
+};
+
+template <>
+struct TaskPromise<void> : TaskPromiseBase {
+    Task<void> get_return_object();
+    void return_void() {}
+
+    void result() {
+        if (exception) {
+            std::rethrow_exception(exception);
+        }
+    }
+};
+
+} // namespace detail
+
+// 可以被co_await的协程，结果为T；只能移动，销毁时一并销毁协程帧
+template <typename T>
+class Task {
+public:
+    typedef detail::TaskPromise<T> promise_type;
+
+    Task() = default;
+    explicit Task(std::coroutine_handle<promise_type> handle) : handle_(handle) {}
+    Task(Task&& other) noexcept : handle_(std::exchange(other.handle_, nullptr)) {}
+    Task& operator=(Task&& other) noexcept {
+        if (this != &other) {
+            reset();
+            handle_ = std::exchange(other.handle_, nullptr);
+        }
+        return *this;
+    }
+    ~Task() { reset(); }
+
+    bool valid() const { return (bool)handle_; }
+    bool done() const { return handle_ && handle_.done(); }
+    std::coroutine_handle<promise_type> handle() const { return handle_; }
+
+    // 销毁协程帧，挂起在其中的子协程一起销毁
+    void reset() {
+        if (handle_) {
+            handle_.destroy();
+            handle_ = nullptr;
+        }
+    }
+
+    bool await_ready() const noexcept { return false; }
+    std::coroutine_handle<> await_suspend(std::coroutine_handle<> awaiting) noexcept {
+        handle_.promise().continuation = awaiting;
+        return handle_;
+    }
+    T await_resume() { return handle_.promise().result(); }
+
+private:
+    std::coroutine_handle<promise_type> handle_;
+};
+
+namespace detail {
+
+template <typename T>
+Task<T> TaskPromise<T>::get_return_object() {
+    return Task<T>(std::coroutine_handle<TaskPromise>::from_promise(*this));
+}
+
+inline Task<void> TaskPromise<void>::get_return_object() {
+    return Task<void>(std::coroutine_handle<TaskPromise>::from_promise(*this));
+}
+
+} // namespace detail
+
+// 协程访问事件循环的入口，由CoroutineHandler在on_attach中按具体的Reactor类型填好，
+// 这里只保存函数指针，不依赖Backend
+struct CoroutineLoop {
+    void* loop = nullptr;
+    TimerWheel::TimerId (*run_after)(void* loop, uint64_t delay_ms, TimerWheel::Callback cb) = nullptr;
+    bool (*cancel_timer)(void* loop, TimerWheel::TimerId id) = nullptr;
+    void (*commit_send)(void* loop, Connection& conn, size_t queued_before) = nullptr;
+    void (*close_later)(void* loop, Connection& conn) = nullptr;
+    void (*hold_input)(void* loop, Connection& conn) = nullptr;
+    void (*release_input)(void* loop, Connection& conn) = nullptr;
+};
+
+// 协程看到的连接，每个连接一个，由CoroutineHandler创建和销毁
+// 每个连接同时只有一个协程链在运行，所以同一时刻最多只有一个等待点。
+class CoConnection {
+public:
+    CoConnection(Connection& conn, const CoroutineLoop& loop, FramePool& pool);
+    ~CoConnection();
+
+    CoConnection(const CoConnection&) = delete;
+    CoConnection& operator=(const CoConnection&) = delete;
+
+    Connection& raw() { return conn_; }
+    ChunkBuffer& input() { return conn_.recv_buffer; }
+
+    // 等到接收缓冲区非空，返回接收缓冲区；处理过的数据由调用者消费掉，否则下一次read()立即返回
+    auto read() {
+        struct Awaiter {
+            CoConnection& io;
+            bool await_ready() const { return !io.conn_.recv_buffer.empty(); }
+            void await_suspend(std::coroutine_handle<> h) { io.wait(WAIT_READ, h); }
+            ChunkBuffer& await_resume() const { return io.conn_.recv_buffer; }
+        };
+        return Awaiter{*this};
+    }
+
+    // 按conn.codec分帧，等到一条完整消息；返回的消息在下一次read_frame()之前有效，
+    // 下一次read_frame()时才从接收缓冲区消费掉。消息超长时连接会被关闭
+    auto read_frame() {
+        struct Awaiter {
+            CoConnection& io;
+            bool await_ready() { return io.next_frame(); }
+            void await_suspend(std::coroutine_handle<> h) { io.wait(WAIT_FRAME, h); }
+            std::string_view await_resume() const { return io.frame_; }
+        };
+        return Awaiter{*this};
+    }
+
+    // 追加到发送缓冲区；发送缓冲区超过高水位时挂起，等数据全部交给内核后继续
+    auto write(std::string_view data) {
+        conn_.send_buffer.append(data.data(), data.size());
+        return DrainAwaiter{*this};
+    }
+    // 把data中的数据块整体移到发送缓冲区，不拷贝
+    auto write(ChunkBuffer& data) {
+        conn_.send_buffer.splice_from(data);
+        return DrainAwaiter{*this};
+    }
+    // 按conn.codec编码后写入
+    auto write_frame(std::string_view payload) {
+        conn_.codec.encode(conn_.send_buffer, payload);
+        return DrainAwaiter{*this};
+    }
+
+    // 挂起delay_ms毫秒，精度是时间轮的tick
+    auto sleep_for(uint64_t delay_ms) {
+        struct Awaiter {
+            CoConnection& io;
+            uint64_t delay_ms;
+            bool await_ready() const { return false; }
+            void await_suspend(std::coroutine_handle<> h) { io.sleep(delay_ms, h); }
+            void await_resume() const {}
+        };
+        return Awaiter{*this, delay_ms};
+    }
+
+    // 以下由CoroutineHandler调用
+    // 启动顶层协程
+    void start(Task<> task);
+    // 事件循环读到新数据后调用，在on_message中，回复由事件循环负责发送
+    void on_input();
+    // 发送缓冲区清空后调用
+    void on_drained();
+    bool finished() const { return finished_; }
+    // 协程正挂起在read()或read_frame()上
+    bool waiting_input() const { return waiting_ == WAIT_READ || waiting_ == WAIT_FRAME; }
+
+private:
+    enum WaitKind { WAIT_NONE, WAIT_READ, WAIT_FRAME, WAIT_DRAIN, WAIT_SLEEP };
+
+    struct DrainAwaiter {
+        CoConnection& io;
+        bool await_ready() const { return !io.conn_.send_buffer.above_high_water(); }
+        void await_suspend(std::coroutine_handle<> h) { io.wait(WAIT_DRAIN, h); }
+        void await_resume() const {}
+    };
+
+    void wait(WaitKind kind, std::coroutine_handle<> h) {
+        waiting_ = kind;
+        waiter_ = h;
+        // 不等待输入期间读取可能被暂停过(见CoroutineHandler::on_message)，重新等待时恢复
+        if (waiting_input()) {
+            loop_.release_input(loop_.loop, conn_);
+        }
+    }
+    void sleep(uint64_t delay_ms, std::coroutine_handle<> h);
+    bool next_frame();
+    // 恢复等待中的协程；commit为true表示不在on_message/on_connect中，追加的回复需要通知事件循环
+    void resume(bool commit);
+
+    Connection& conn_;
+    const CoroutineLoop& loop_;
+    FramePool& pool_;
+    Task<> task_;
+    std::coroutine_handle<> waiter_;
+    WaitKind waiting_;
+    TimerWheel::TimerId timer_;
+    std::string_view frame_;
+    bool frame_pending_;    // frame_还没有从接收缓冲区消费掉
+    bool finished_;
+};
+
+// 协程处理器基类(CRTP)
+// 派生类实现 Task<> serve(CoConnection& io)，每个连接建立时启动一个；serve返回后连接在回复发完时关闭。
+// CoConnection和协程帧都从本事件循环的FramePool分配。
+template <typename Derived>
+class CoroutineHandler : public ReactorHandler<Derived> {
+public:
+    template <typename Loop>
+    void on_attach(Loop& loop) {
+        loop_.loop = &loop;
+        loop_.run_after = [](void* l, uint64_t delay_ms, TimerWheel::Callback cb) {
+            return static_cast<Loop*>(l)->run_after(delay_ms, std::move(cb));
+        };
+        loop_.cancel_timer = [](void* l, TimerWheel::TimerId id) { return static_cast<Loop*>(l)->cancel_timer(id); };
+        loop_.commit_send = [](void* l, Connection& conn, size_t queued_before) {
+            static_cast<Loop*>(l)->commit_send(conn, queued_before);
+        };
+        loop_.close_later = [](void* l, Connection& conn) { static_cast<Loop*>(l)->close_later(conn); };
+        loop_.hold_input = [](void* l, Connection& conn) { static_cast<Loop*>(l)->hold_input(conn); };
+        loop_.release_input = [](void* l, Connection& conn) { static_cast<Loop*>(l)->release_input(conn); };
+    }
+
+    void on_connect(Connection& conn) {
+        if ((size_t)conn.fd >= connections_.size()) {
+            connections_.resize(conn.fd + 1, nullptr);
+        }
+        void* storage = pool_.allocate(sizeof(CoConnection));
+        CoConnection* io = new (storage) CoConnection(conn, loop_, pool_);
+        connections_[conn.fd] = io;
+
+        FramePool::Scope scope(pool_);
+        io->start(static_cast<Derived*>(this)->serve(*io));
+    }
+
+    void on_message(Connection& conn, ChunkBuffer& in) {
+        CoConnection* io = connections_[conn.fd];
+        if (io->finished()) {
+            // 协程已经结束，连接等待关闭，后到的数据直接丢弃
+            in.clear();
+            return;
+        }
+        io->on_input();
+        // 协程在sleep、等待发送或者还没读完上一批时，新数据只会堆在接收缓冲区，超过高水位暂停读取，
+        // 协程再次等待输入时恢复
+        if (!io->finished() && !io->waiting_input()) {
+            loop_.hold_input(loop_.loop, conn);
+        }
+    }
+
+    void on_drained(Connection& conn) {
+        CoConnection* io = connections_[conn.fd];
+        if (io) {
+            io->on_drained();
+        }
+    }
+
+    void on_close(Connection& conn) {
+        CoConnection* io = connections_[conn.fd];
+        connections_[conn.fd] = nullptr;
+        io->~CoConnection();
+        pool_.deallocate(io, sizeof(CoConnection));
+    }
+
+    const FramePool& frame_pool() const { return pool_; }
+
+private:
+    CoroutineLoop loop_;
+    FramePool pool_;
+    std::vector<CoConnection*> connections_;    // 按fd索引
+};
+
+#endif // COROUTINE_H
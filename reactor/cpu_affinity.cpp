@@ -0,0 +1,73 @@
+#include "cpu_affinity.h"
+
+#include <linux/mempolicy.h>
+#include <pthread.h>
+#include <sched.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#include <errno.h>
+
+#include <cstdlib>
+#include <cstring>
+#include <stdexcept>
+
+std::vector<int> parse_cpu_list(const std::string& list) {
+    std::vector<int> cpus;
+    size_t pos = 0;
+    while (pos < list.size()) {
+        size_t end = list.find(',', pos);
+        if (end == std::string::npos) {
+            end = list.size();
+        }
+        std::string item = list.substr(pos, end - pos);
+        pos = end + 1;
+
+        char* rest;
+        long first = strtol(item.c_str(), &rest, 10);
+        long last = first;
+        if (*rest == '-') {
+            last = strtol(rest + 1, &rest, 10);
+        }
+        if (item.empty() || *rest != '\0' || first < 0 || last < first || last >= CPU_SETSIZE) {
+            throw std::runtime_error("invalid cpu list: " + list);
+        }
+        for (long cpu = first; cpu <= last; cpu++) {
+            cpus.push_back((int)cpu);
+        }
+    }
+    if (cpus.empty()) {
+        throw std::runtime_error("invalid cpu list: " + list);
+    }
+    return cpus;
+}
+
+void pin_current_thread(const std::vector<int>& cpus) {
+    cpu_set_t set;
+    CPU_ZERO(&set);
+    for (int cpu : cpus) {
+        CPU_SET(cpu, &set);
+    }
+    int ret = pthread_setaffinity_np(pthread_self(), sizeof(set), &set);
+    if (ret != 0) {
+        throw std::runtime_error(std::string("pthread_setaffinity_np failed: ") + strerror(ret));
+    }
+}
+
+void use_local_memory() {
+    // 只用到set_mempolicy一个系统调用，不依赖libnuma
+    if (syscall(SYS_set_mempolicy, MPOL_LOCAL, nullptr, 0) == -1) {
+        throw std::runtime_error(std::string("set_mempolicy failed: ") + strerror(errno));
+    }
+}
+
+int current_cpu() {
+    unsigned cpu = 0;
+    unsigned node = 0;
+    return syscall(SYS_getcpu, &cpu, &node, nullptr) == 0 ? (int)cpu : -1;
+}
+
+int current_numa_node() {
+    unsigned cpu = 0;
+    unsigned node = 0;
+    return syscall(SYS_getcpu, &cpu, &node, nullptr) == 0 ? (int)node : -1;
+}
@@ -0,0 +1,23 @@
+#ifndef CPU_AFFINITY_H
+#define CPU_AFFINITY_H
+
+#include <string>
+#include <vector>
+
+// 事件循环线程的CPU和NUMA放置
+
+// 解析 "0-3,8,10-11" 形式的CPU列表，格式错误时抛出异常
+std::vector<int> parse_cpu_list(const std::string& list);
+
+// 把调用线程绑定到cpus中的CPU上，失败时抛出异常
+void pin_current_thread(const std::vector<int>& cpus);
+
+// 调用线程之后分配的内存优先放在它当前运行的CPU所在的NUMA节点上(MPOL_LOCAL)，
+// 与默认的首次访问策略相比，不受进程级策略(如numactl --interleave)影响；失败时抛出异常
+void use_local_memory();
+
+// 调用线程当前所在的CPU和NUMA节点，用于日志
+int current_cpu();
+int current_numa_node();
+
+#endif // CPU_AFFINITY_H
@@ -0,0 +1,43 @@
+#ifndef ECHO_HANDLER_H
+#define ECHO_HANDLER_H
+
+#include <string>
+#include <string_view>
+
+#include "reactor.h"
+
+// Echo协议：把收到的数据原样发回
+class EchoHandler : public ReactorHandler<EchoHandler> {
+public:
+    // 原样回显，大块数据可以splice直通
+    static constexpr bool passthrough = true;
+
+    explicit EchoHandler(const std::string& welcome_message = "")
+        : welcome_message_(welcome_message) {}
+
+    void on_connect(Connection& conn) {
+        // 发送欢迎消息
+        if (!welcome_message_.empty()) {
+            conn.send_buffer.append(welcome_message_);
+        }
+    }
+
+    void on_message(Connection& conn, ChunkBuffer& in) {
+        if (conn.codec.mode() != FrameMode::RAW) {
+            // 按消息回显
+            ReactorHandler<EchoHandler>::on_message(conn, in);
+            return;
+        }
+        // 把接收缓冲区的数据块整体移到发送缓冲区，不拷贝数据
+        conn.send_buffer.splice_from(in);
+    }
+
+    void on_frame(Connection& conn, std::string_view frame) {
+        conn.codec.encode(conn.send_buffer, frame);
+    }
+
+private:
+    std::string welcome_message_;
+};
+
+#endif // ECHO_HANDLER_H
@@ -0,0 +1,794 @@
+#include "epoll_echo_server.h"
+#include "latency_histogram.h"
+#if __cplusplus >= 202002L
+#include "co_echo_handler.h"
+#endif
+#include <netinet/tcp.h>
+#include <poll.h>
+#include <time.h>
+#include <csignal>
+#include <atomic>
+#include <chrono>
+#include <iostream>
+#include <thread>
+#include <vector>
+#include <cstdlib>
+
+// EpollEchoServer 回环压测
+// 用法:
+//   ./epoll_bench scaling [最大线程数] [连接数] [每轮秒数] [lt|et]
+//       分别用 1..N 个事件循环线程启动服务器，统计每秒请求数
+//   ./epoll_bench syscalls [连接数] [每轮秒数] [流水线深度]
+//       对比 recv/send 与 readv/writev 两种路径下每个请求的系统调用数
+//   ./epoll_bench splice [连接数] [每轮秒数]
+//       64KB~1MB的大消息下对比普通拷贝路径与splice直通的带宽和服务器CPU占用
+//   ./epoll_bench transport [连接数] [每轮秒数] [流水线深度]
+//       同样的echo负载分别走回环TCP和Unix域socket，对比每秒请求数和平均往返时间
+//   ./epoll_bench storm [客户端线程数] [每轮秒数]
+//       连接风暴：客户端不停地建立连接、读欢迎消息、断开，对比每次唤醒只accept一个连接
+//       与批量accept加大监听队列时每秒建立的连接数
+//   ./epoll_bench latency [连接数] [每轮秒数] [请求间隔微秒]
+//       低负载往返延迟：每个连接一个客户端线程，发一条等一条，两次请求之间停顿一段时间让事件循环空闲；
+//       对比默认、绑核、忙轮询、绑核+忙轮询下的p50/p99/p99.9
+//   ./epoll_bench tcp [每轮秒数]
+//       对比default/latency/throughput三种TCP参数预设下的单连接往返延迟、流水线请求数和大消息带宽
+//   ./epoll_bench offload-stop [轮数]
+//       工作线程池模式下反复启动服务器，客户端不停地发请求，在任务还在工作线程中处理时停止服务器；
+//       检查事件循环销毁时没有工作线程还在访问它(配合-fsanitize=address/thread编译)
+//   ./epoll_bench throttle-release
+//       两个只发不收的连接把发送缓冲区总积压推过全局高水位，另一个连接随之被暂停读取；
+//       关闭这两个连接后检查被暂停的连接立即恢复，没有恢复时退出码非0
+//   ./epoll_bench coro [连接数] [每轮秒数] [流水线深度]
+//       单个事件循环上对比回调式EchoHandler与协程式CoEchoHandler的每秒请求数(需要-std=c++20编译)
+//   ./epoll_bench coflood [每轮秒数]
+//       客户端不停地发送、不读回复，服务器协程每读到一次数据就sleep一段时间；检查接收缓冲区
+//       停在高水位附近而不是无限增长，超出时退出码非0(需要-std=c++20编译)
+
+static const char kWelcomeTail = '\n';
+static const char kMessage[] = "ping\n";
+static const size_t kMessageLen = sizeof(kMessage) - 1;
+
+static int connect_address(const SocketAddress& addr) {
+    // 服务器线程可能还没开始监听，重试几次
+    for (int retry = 0; retry < 100; retry++) {
+        int fd = socket(addr.family(), SOCK_STREAM, 0);
+        if (fd == -1) {
+            throw std::runtime_error("Failed to create socket");
+        }
+        if (connect(fd, addr.data(), addr.size()) == 0) {
+            if (!addr.is_unix()) {
+                int opt = 1;
+                setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &opt, sizeof(opt));
+            }
+            return fd;
+        }
+        close(fd);
+        std::this_thread::sleep_for(std::chrono::milliseconds(10));
+    }
+    throw std::runtime_error("connect failed");
+}
+
+static int connect_loopback(int port) {
+    return connect_address(SocketAddress::resolve("127.0.0.1", port));
+}
+
+static bool read_exact(int fd, char* buf, size_t len) {
+    size_t got = 0;
+    while (got < len) {
+        ssize_t n = recv(fd, buf + got, len - got, 0);
+        if (n <= 0) {
+            return false;
+        }
+        got += n;
+    }
+    return true;
+}
+
+// 读掉服务器发送的欢迎消息（以换行结尾）
+static bool skip_welcome(int fd) {
+    char c;
+    while (recv(fd, &c, 1, 0) == 1) {
+        if (c == kWelcomeTail) {
+            return true;
+        }
+    }
+    return false;
+}
+
+// 每个客户端线程持有若干连接，每轮在所有连接上各发depth条消息再逐个读回
+static void client_worker(SocketAddress addr, int num_conns, int depth, std::atomic<bool>& running,
+                          std::atomic<long>& requests) {
+    std::vector<int> fds;
+    for (int i = 0; i < num_conns; i++) {
+        int fd = connect_address(addr);
+        if (!skip_welcome(fd)) {
+            close(fd);
+            continue;
+        }
+        fds.push_back(fd);
+    }
+
+    std::vector<char> reply(kMessageLen * depth);
+    long local = 0;
+    while (running && !fds.empty()) {
+        for (int fd : fds) {
+            for (int i = 0; i < depth; i++) {
+                send(fd, kMessage, kMessageLen, 0);
+            }
+        }
+        for (int fd : fds) {
+            if (!read_exact(fd, reply.data(), reply.size())) {
+                running = false;
+                break;
+            }
+        }
+        local += fds.size() * depth;
+    }
+
+    for (int fd : fds) {
+        close(fd);
+    }
+    requests += local;
+}
+
+struct RoundResult {
+    double requests_per_sec;
+    double syscalls_per_request;
+};
+
+static RoundResult run_round(int port, const EpollServerOptions& options, int num_conns,
+                             int seconds, int depth = 1, const std::string& host = "127.0.0.1") {
+    EpollEchoServer server(host, port, options);
+    SocketAddress addr = SocketAddress::resolve(host, port);
+    std::thread server_thread([&server]() { server.start(); });
+
+    int client_threads = std::max(1, std::min(num_conns, (int)std::thread::hardware_concurrency()));
+    std::atomic<bool> running{true};
+    std::atomic<long> requests{0};
+    std::vector<std::thread> clients;
+    for (int i = 0; i < client_threads; i++) {
+        int conns = num_conns / client_threads + (i < num_conns % client_threads ? 1 : 0);
+        clients.emplace_back(client_worker, addr, conns, depth, std::ref(running), std::ref(requests));
+    }
+
+    std::this_thread::sleep_for(std::chrono::seconds(seconds));
+    running = false;
+    for (auto& t : clients) {
+        t.join();
+    }
+
+    server.stop();
+    server_thread.join();
+
+    RoundResult result;
+    result.requests_per_sec = (double)requests / seconds;
+    result.syscalls_per_request = requests ? (double)server.stats().syscalls() / requests : 0;
+    return result;
+}
+
+// 大消息压测：每个连接一个线程持续发送，另一个线程持续读回，统计回显的字节数
+static void bulk_sender(int fd, size_t message_size, std::atomic<bool>& running) {
+    std::vector<char> message(message_size, 'x');
+    while (running) {
+        if (send(fd, message.data(), message.size(), MSG_NOSIGNAL) <= 0) {
+            break;
+        }
+    }
+}
+
+static void bulk_receiver(int fd, std::atomic<long>& bytes) {
+    std::vector<char> buffer(256 * 1024);
+    long local = 0;
+    ssize_t n;
+    while ((n = recv(fd, buffer.data(), buffer.size(), 0)) > 0) {
+        local += n;
+    }
+    bytes += local;
+}
+
+static double thread_cpu_seconds() {
+    timespec ts;
+    clock_gettime(CLOCK_THREAD_CPUTIME_ID, &ts);
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+struct BulkResult {
+    double mb_per_sec;
+    double cpu_seconds_per_gb;      // 服务器事件循环线程每转发1GB消耗的CPU秒数
+};
+
+static BulkResult run_bulk_round(int port, const EpollServerOptions& options, int num_conns,
+                                 int seconds, size_t message_size) {
+    EpollEchoServer server("127.0.0.1", port, options);
+    double server_cpu = 0;
+    std::thread server_thread([&server, &server_cpu]() {
+        double begin = thread_cpu_seconds();
+        server.start();
+        server_cpu = thread_cpu_seconds() - begin;
+    });
+
+    std::atomic<bool> running{true};
+    std::atomic<long> bytes{0};
+    std::vector<int> fds;
+    std::vector<std::thread> threads;
+    for (int i = 0; i < num_conns; i++) {
+        int fd = connect_loopback(port);
+        if (!skip_welcome(fd)) {
+            close(fd);
+            continue;
+        }
+        fds.push_back(fd);
+        threads.emplace_back(bulk_sender, fd, message_size, std::ref(running));
+        threads.emplace_back(bulk_receiver, fd, std::ref(bytes));
+    }
+
+    std::this_thread::sleep_for(std::chrono::seconds(seconds));
+    running = false;
+    // 唤醒阻塞在send/recv上的线程
+    for (int fd : fds) {
+        shutdown(fd, SHUT_RDWR);
+    }
+    for (auto& t : threads) {
+        t.join();
+    }
+    for (int fd : fds) {
+        close(fd);
+    }
+
+    server.stop();
+    server_thread.join();
+
+    BulkResult result;
+    double gb = (double)bytes / (1024.0 * 1024 * 1024);
+    result.mb_per_sec = (double)bytes / (1024.0 * 1024) / seconds;
+    result.cpu_seconds_per_gb = gb > 0 ? server_cpu / gb : 0;
+    return result;
+}
+
+static void bench_splice(int argc, char* argv[]) {
+    int num_conns = argc > 2 ? atoi(argv[2]) : 4;
+    int seconds = argc > 3 ? atoi(argv[3]) : 3;
+    const size_t sizes[] = {64 * 1024, 256 * 1024, 1024 * 1024};
+
+    std::cerr << "连接数: " << num_conns << ", 每轮 " << seconds << " 秒" << std::endl;
+    int port = 19200;
+    for (size_t size : sizes) {
+        BulkResult results[2];
+        for (int i = 0; i < 2; i++) {
+            EpollServerOptions options;
+            options.drain_on_wakeup = true;
+            options.max_io_bytes_per_wakeup = 1024 * 1024;
+            options.splice_threshold = (i == 1) ? size : 0;
+            results[i] = run_bulk_round(port++, options, num_conns, seconds, size);
+        }
+        std::cerr << "消息 " << size / 1024 << "KB: 拷贝 " << (long)results[0].mb_per_sec << " MB/s, "
+                  << results[0].cpu_seconds_per_gb << " CPU秒/GB; splice "
+                  << (long)results[1].mb_per_sec << " MB/s, " << results[1].cpu_seconds_per_gb
+                  << " CPU秒/GB" << std::endl;
+    }
+}
+
+static void bench_transport(int argc, char* argv[]) {
+    int num_conns = argc > 2 ? atoi(argv[2]) : 64;
+    int seconds = argc > 3 ? atoi(argv[3]) : 3;
+    int depth = argc > 4 ? atoi(argv[4]) : 1;
+    if (depth < 1) {
+        depth = 1;
+    }
+
+    std::string unix_path = "unix:/tmp/epoll_bench." + std::to_string(getpid()) + ".sock";
+    const char* names[] = {"回环TCP", "Unix域socket"};
+    const std::string hosts[] = {"127.0.0.1", unix_path};
+    RoundResult results[2];
+    for (int i = 0; i < 2; i++) {
+        EpollServerOptions options;
+        results[i] = run_round(19400 + i, options, num_conns, seconds, depth, hosts[i]);
+    }
+    unlink(unix_path.c_str() + 5);
+
+    // 闭环压测中每个连接始终有depth条消息在途，平均往返时间 = 在途消息数 / 吞吐
+    std::cerr << "连接数: " << num_conns << ", 每轮 " << seconds << " 秒, 流水线深度 " << depth << std::endl;
+    for (int i = 0; i < 2; i++) {
+        double rtt_us = results[i].requests_per_sec > 0
+                            ? num_conns * depth * 1e6 / results[i].requests_per_sec : 0;
+        std::cerr << names[i] << ": " << (long)results[i].requests_per_sec << " req/s, 平均往返 "
+                  << rtt_us << " us" << std::endl;
+    }
+}
+
+// 连接风暴：每个线程循环建立短连接，读到欢迎消息算一次成功
+// 用SO_LINGER(0)以RST关闭，客户端不留TIME_WAIT，否则几秒内就会耗尽本地端口
+static void storm_worker(int port, std::atomic<bool>& running, std::atomic<long>& connects,
+                         std::atomic<long>& failures) {
+    sockaddr_in addr;
+    memset(&addr, 0, sizeof(addr));
+    addr.sin_family = AF_INET;
+    addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    addr.sin_port = htons(port);
+    linger lin = {1, 0};
+
+    long local = 0;
+    long failed = 0;
+    while (running) {
+        int fd = socket(AF_INET, SOCK_STREAM | SOCK_CLOEXEC, 0);
+        if (fd == -1) {
+            break;
+        }
+        setsockopt(fd, SOL_SOCKET, SO_LINGER, &lin, sizeof(lin));
+        if (connect(fd, (sockaddr*)&addr, sizeof(addr)) == 0 && skip_welcome(fd)) {
+            local++;
+        } else {
+            failed++;
+        }
+        close(fd);
+    }
+    connects += local;
+    failures += failed;
+}
+
+struct StormResult {
+    double connects_per_sec;
+    double syscalls_per_connect;
+    long failures;
+};
+
+static StormResult run_storm_round(int port, const EpollServerOptions& options, int client_threads,
+                                   int seconds) {
+    EpollEchoServer server("127.0.0.1", port, options);
+    std::thread server_thread([&server]() { server.start(); });
+    // 等服务器开始监听
+    close(connect_loopback(port));
+
+    std::atomic<bool> running{true};
+    std::atomic<long> connects{0};
+    std::atomic<long> failures{0};
+    std::vector<std::thread> clients;
+    for (int i = 0; i < client_threads; i++) {
+        clients.emplace_back(storm_worker, port, std::ref(running), std::ref(connects), std::ref(failures));
+    }
+
+    std::this_thread::sleep_for(std::chrono::seconds(seconds));
+    running = false;
+    for (auto& t : clients) {
+        t.join();
+    }
+
+    server.stop();
+    server_thread.join();
+
+    StormResult result;
+    result.connects_per_sec = (double)connects / seconds;
+    result.syscalls_per_connect = connects ? (double)server.stats().syscalls() / connects : 0;
+    result.failures = failures;
+    return result;
+}
+
+static void bench_storm(int argc, char* argv[]) {
+    int client_threads = argc > 2 ? atoi(argv[2]) : 2 * (int)std::thread::hardware_concurrency();
+    int seconds = argc > 3 ? atoi(argv[3]) : 3;
+    if (client_threads < 1) {
+        client_threads = 1;
+    }
+    // 客户端以RST断开，服务器每个连接都会报一次错误事件，这里不输出
+    Logger::set_level(LOG_LEVEL_ERROR);
+
+    const char* names[] = {"单个accept, backlog 128", "批量accept 64, backlog SOMAXCONN"};
+    StormResult results[2];
+    for (int i = 0; i < 2; i++) {
+        EpollServerOptions options;
+        options.max_accepts_per_wakeup = (i == 0) ? 1 : 64;
+        options.listen_backlog = (i == 0) ? 128 : SOMAXCONN;
+        results[i] = run_storm_round(19300 + i, options, client_threads, seconds);
+    }
+
+    std::cerr << "客户端线程数: " << client_threads << ", 每轮 " << seconds << " 秒" << std::endl;
+    for (int i = 0; i < 2; i++) {
+        std::cerr << names[i] << ": " << (long)results[i].connects_per_sec << " conn/s, "
+                  << results[i].syscalls_per_connect << " syscalls/conn, 失败 "
+                  << results[i].failures << std::endl;
+    }
+}
+
+static void bench_scaling(int argc, char* argv[]) {
+    int max_threads = argc > 2 ? atoi(argv[2]) : (int)std::thread::hardware_concurrency();
+    int num_conns = argc > 3 ? atoi(argv[3]) : 64;
+    int seconds = argc > 4 ? atoi(argv[4]) : 3;
+    bool edge_triggered = argc > 5 && strcmp(argv[5], "et") == 0;
+    if (max_threads < 1) {
+        max_threads = 1;
+    }
+
+    std::vector<double> results;
+    for (int n = 1; n <= max_threads; n++) {
+        EpollServerOptions options;
+        options.num_threads = n;
+        options.edge_triggered = edge_triggered;
+        results.push_back(run_round(19000 + n, options, num_conns, seconds).requests_per_sec);
+    }
+
+    std::cerr << "连接数: " << num_conns << ", 每轮 " << seconds << " 秒, "
+              << (edge_triggered ? "边沿触发" : "水平触发") << std::endl;
+    for (int n = 1; n <= max_threads; n++) {
+        std::cerr << "线程数 " << n << ": " << (long)results[n - 1] << " req/s"
+                  << " (x" << results[n - 1] / results[0] << ")" << std::endl;
+    }
+}
+
+// 不读回复、只管发送的客户端，服务器停止或连接断开时退出
+static void flood_client(int port, std::atomic<bool>& running) {
+    int fd = connect_loopback(port);
+    set_non_blocking(fd);
+    char message[64 * kMessageLen];
+    for (size_t i = 0; i < sizeof(message); i += kMessageLen) {
+        memcpy(message + i, kMessage, kMessageLen);
+    }
+    char discard[64 * 1024];
+    while (running) {
+        ssize_t n = send(fd, message, sizeof(message), MSG_NOSIGNAL);
+        if (n == -1 && errno != EAGAIN) {
+            break;
+        }
+        n = recv(fd, discard, sizeof(discard), 0);
+        if (n == 0 || (n == -1 && errno != EAGAIN)) {
+            break;
+        }
+    }
+    close(fd);
+}
+
+static void bench_offload_stop(int argc, char* argv[]) {
+    int rounds = argc > 2 ? atoi(argv[2]) : 100;
+    EpollServerOptions options;
+    options.num_threads = 2;
+    options.worker_threads = 4;
+    options.frame_mode = FrameMode::LINE;
+
+    long offloaded = 0;
+    for (int round = 0; round < rounds; round++) {
+        int port = 19500 + round % 50;
+        EpollEchoServer server("127.0.0.1", port, options);
+        std::thread server_thread([&server]() { server.start(); });
+
+        std::atomic<bool> running{true};
+        std::vector<std::thread> clients;
+        for (int i = 0; i < 4; i++) {
+            clients.emplace_back(flood_client, port, std::ref(running));
+        }
+        // 停止时工作线程里还有没交回的任务
+        std::this_thread::sleep_for(std::chrono::milliseconds(20 + round % 10));
+        server.stop();
+        server_thread.join();
+
+        running = false;
+        for (auto& t : clients) {
+            t.join();
+        }
+        offloaded += server.stats().offloaded_tasks.value();
+    }
+    std::cerr << rounds << " 轮启停完成，共交给工作线程 " << offloaded << " 批请求" << std::endl;
+}
+
+// 在timeout_ms内收到一条完整的回显
+static bool wait_reply(int fd, int timeout_ms) {
+    pollfd pfd = {fd, POLLIN, 0};
+    if (poll(&pfd, 1, timeout_ms) != 1) {
+        return false;
+    }
+    char reply[kMessageLen];
+    return read_exact(fd, reply, sizeof(reply));
+}
+
+static bool bench_throttle_release(int argc, char* argv[]) {
+    (void)argc;
+    (void)argv;
+    const int port = 19560;
+    EpollServerOptions options;
+    // 单个连接的水位足够高，只有全局限流会暂停读取
+    options.send_high_water_mark = 64 * 1024 * 1024;
+    options.send_low_water_mark = 32 * 1024 * 1024;
+    options.global_high_water_mark = 1024 * 1024;
+    options.global_low_water_mark = 512 * 1024;
+    EpollEchoServer server("127.0.0.1", port, options);
+    std::thread server_thread([&server]() { server.start(); });
+
+    int light = connect_loopback(port);
+    skip_welcome(light);
+
+    // 重负载连接发送大量数据但不读回显，回显积压在服务器的发送缓冲区里
+    std::vector<int> heavy;
+    std::vector<char> chunk(64 * 1024, 'x');
+    for (int i = 0; i < 2; i++) {
+        int fd = connect_loopback(port);
+        set_non_blocking(fd);
+        heavy.push_back(fd);
+    }
+    for (int round = 0; round < 200; round++) {
+        for (int fd : heavy) {
+            ssize_t n = send(fd, chunk.data(), chunk.size(), MSG_NOSIGNAL);
+            (void)n;
+        }
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    }
+
+    // 限流期间第一条请求照常读到并回复，之后该连接暂停读取，第二条收不到回复
+    send(light, kMessage, kMessageLen, 0);
+    bool first = wait_reply(light, 1000);
+    send(light, kMessage, kMessageLen, 0);
+    bool throttled = !wait_reply(light, 300);
+
+    for (int fd : heavy) {
+        close(fd);
+    }
+    bool resumed = wait_reply(light, 1000);
+    close(light);
+
+    server.stop();
+    server_thread.join();
+
+    bool ok = first && throttled && resumed;
+    std::cerr << "全局限流 " << server.stats().global_throttles.value() << " 次, 限流前回复: "
+              << (first ? "是" : "否") << ", 限流中被暂停: " << (throttled ? "是" : "否")
+              << ", 重负载连接关闭后恢复: " << (resumed ? "是" : "否") << ": " << (ok ? "OK" : "FAIL") << std::endl;
+    return ok;
+}
+
+#if __cplusplus >= 202002L
+// 直接在当前进程里跑一个Reactor，处理器由调用者给出
+template <typename Handler>
+static double run_reactor_round(int port, const Handler& handler, int num_conns, int seconds, int depth) {
+    Reactor<EpollBackend, Handler> server("127.0.0.1", port, ReactorOptions(), handler);
+    std::thread server_thread([&server]() { server.start(); });
+
+    SocketAddress addr = SocketAddress::resolve("127.0.0.1", port);
+    int client_threads = std::max(1, std::min(num_conns, (int)std::thread::hardware_concurrency()));
+    std::atomic<bool> running{true};
+    std::atomic<long> requests{0};
+    std::vector<std::thread> clients;
+    for (int i = 0; i < client_threads; i++) {
+        int conns = num_conns / client_threads + (i < num_conns % client_threads ? 1 : 0);
+        clients.emplace_back(client_worker, addr, conns, depth, std::ref(running), std::ref(requests));
+    }
+
+    std::this_thread::sleep_for(std::chrono::seconds(seconds));
+    running = false;
+    for (auto& t : clients) {
+        t.join();
+    }
+
+    server.stop();
+    server_thread.join();
+    return (double)requests / seconds;
+}
+
+static void bench_coro(int argc, char* argv[]) {
+    int num_conns = argc > 2 ? atoi(argv[2]) : 64;
+    int seconds = argc > 3 ? atoi(argv[3]) : 3;
+    int depth = argc > 4 ? atoi(argv[4]) : 1;
+    if (depth < 1) {
+        depth = 1;
+    }
+
+    double callback = run_reactor_round(19400, EchoHandler("Welcome\n"), num_conns, seconds, depth);
+    double coroutine = run_reactor_round(19401, CoEchoHandler("Welcome\n"), num_conns, seconds, depth);
+
+    std::cerr << "连接数: " << num_conns << ", 每轮 " << seconds << " 秒, 流水线深度 " << depth << std::endl;
+    std::cerr << "回调: " << (long)callback << " req/s" << std::endl;
+    std::cerr << "协程: " << (long)coroutine << " req/s ("
+              << (callback > 0 ? (coroutine / callback - 1) * 100 : 0) << "%)" << std::endl;
+}
+
+// 每读到一次数据就sleep的协程处理器，记录醒来时接收缓冲区里积压的最大字节数
+class SleepyHandler : public CoroutineHandler<SleepyHandler> {
+public:
+    explicit SleepyHandler(uint64_t sleep_ms = 200) : sleep_ms_(sleep_ms), max_buffered_(0) {}
+
+    Task<> serve(CoConnection& io) {
+        while (true) {
+            ChunkBuffer& in = co_await io.read();
+            co_await io.sleep_for(sleep_ms_);
+            max_buffered_ = std::max(max_buffered_, in.size());
+            in.clear();
+        }
+    }
+
+    size_t max_buffered() const { return max_buffered_; }
+
+private:
+    uint64_t sleep_ms_;
+    size_t max_buffered_;
+};
+
+static bool bench_coflood(int argc, char* argv[]) {
+    int seconds = argc > 2 ? atoi(argv[2]) : 3;
+    const int port = 19402;
+
+    ReactorOptions options;
+    Reactor<EpollBackend, SleepyHandler> server("127.0.0.1", port, options, SleepyHandler(200));
+    std::thread server_thread([&server]() { server.start(); });
+
+    // 非阻塞发送，内核缓冲区满时稍等再试，服务器停止读取后客户端就发不出去了
+    int fd = connect_loopback(port);
+    set_non_blocking(fd);
+    std::vector<char> chunk(64 * 1024, 'x');
+    long sent = 0;
+    auto deadline = std::chrono::steady_clock::now() + std::chrono::seconds(seconds);
+    while (std::chrono::steady_clock::now() < deadline) {
+        ssize_t n = send(fd, chunk.data(), chunk.size(), MSG_NOSIGNAL);
+        if (n > 0) {
+            sent += n;
+        } else {
+            std::this_thread::sleep_for(std::chrono::milliseconds(1));
+        }
+    }
+    close(fd);
+
+    server.stop();
+    server_thread.join();
+
+    // 暂停读取前最多再读进一次数据，留一倍的余量
+    size_t buffered = server.handler().max_buffered();
+    size_t limit = 2 * options.send_high_water_mark;
+    bool ok = buffered <= limit;
+    std::cerr << "客户端发送 " << sent << " 字节，协程sleep期间接收缓冲区最多积压 " << buffered
+              << " 字节 (上限 " << limit << "): " << (ok ? "OK" : "FAIL") << std::endl;
+    return ok;
+}
+#endif
+
+// 单连接往返，记录每个请求的延迟(纳秒)
+static void latency_worker(int port, int gap_us, std::atomic<bool>& running, LatencyHistogram& hist) {
+    int fd = connect_loopback(port);
+    if (!skip_welcome(fd)) {
+        close(fd);
+        return;
+    }
+    char reply[kMessageLen];
+    timespec gap = {0, gap_us * 1000L};
+    while (running) {
+        timespec begin, end;
+        clock_gettime(CLOCK_MONOTONIC, &begin);
+        send(fd, kMessage, kMessageLen, 0);
+        if (!read_exact(fd, reply, kMessageLen)) {
+            break;
+        }
+        clock_gettime(CLOCK_MONOTONIC, &end);
+        hist.record((end.tv_sec - begin.tv_sec) * 1000000000L + (end.tv_nsec - begin.tv_nsec));
+        if (gap_us > 0) {
+            nanosleep(&gap, nullptr);
+        }
+    }
+    close(fd);
+}
+
+static LatencyHistogram run_latency_round(int port, const EpollServerOptions& options, int num_conns,
+                                          int seconds, int gap_us) {
+    EpollEchoServer server("127.0.0.1", port, options);
+    std::thread server_thread([&server]() { server.start(); });
+
+    std::atomic<bool> running{true};
+    std::vector<LatencyHistogram> hists(num_conns);
+    std::vector<std::thread> clients;
+    for (int i = 0; i < num_conns; i++) {
+        clients.emplace_back(latency_worker, port, gap_us, std::ref(running), std::ref(hists[i]));
+    }
+
+    std::this_thread::sleep_for(std::chrono::seconds(seconds));
+    running = false;
+    for (auto& t : clients) {
+        t.join();
+    }
+
+    server.stop();
+    server_thread.join();
+
+    LatencyHistogram total;
+    for (const LatencyHistogram& hist : hists) {
+        total.merge(hist);
+    }
+    return total;
+}
+
+static void bench_latency(int argc, char* argv[]) {
+    int num_conns = argc > 2 ? atoi(argv[2]) : 4;
+    int seconds = argc > 3 ? atoi(argv[3]) : 3;
+    int gap_us = argc > 4 ? atoi(argv[4]) : 50;
+
+    // 服务器绑在最后一个CPU上，客户端线程留给调度器
+    int cpu = (int)std::thread::hardware_concurrency() - 1;
+    const char* names[] = {"默认", "绑核", "忙轮询", "绑核+忙轮询"};
+    std::cerr << "连接数: " << num_conns << ", 每轮 " << seconds << " 秒, 请求间隔 " << gap_us
+              << " 微秒, 服务器CPU " << cpu << std::endl;
+    for (int i = 0; i < 4; i++) {
+        EpollServerOptions options;
+        if (i & 1) {
+            options.cpus = {cpu};
+            options.numa_local = true;
+        }
+        if (i & 2) {
+            options.busy_poll_us = 200;
+        }
+        LatencyHistogram hist = run_latency_round(19300 + i, options, num_conns, seconds, gap_us);
+        std::cerr << names[i] << ": " << hist.count() / seconds << " req/s, p50 " << hist.percentile(50) / 1000.0
+                  << " us, p99 " << hist.percentile(99) / 1000.0 << " us, p99.9 "
+                  << hist.percentile(99.9) / 1000.0 << " us" << std::endl;
+    }
+}
+
+static void bench_tcp(int argc, char* argv[]) {
+    int seconds = argc > 2 ? atoi(argv[2]) : 3;
+
+    const char* profiles[] = {"default", "latency", "throughput"};
+    std::cerr << "每轮 " << seconds << " 秒; 往返: 1个连接一问一答; 流水线: 64个连接各16条; 大消息: 4个连接256KB"
+              << std::endl;
+    int port = 19500;
+    for (const char* name : profiles) {
+        EpollServerOptions options;
+        options.tcp = TcpProfile::preset(name);
+        LatencyHistogram hist = run_latency_round(port++, options, 1, seconds, 0);
+        RoundResult pipelined = run_round(port++, options, 64, seconds, 16);
+        BulkResult bulk = run_bulk_round(port++, options, 4, seconds, 256 * 1024);
+        std::cerr << name << ": 往返 p50 " << hist.percentile(50) / 1000.0 << " us, p99 "
+                  << hist.percentile(99) / 1000.0 << " us; 流水线 " << (long)pipelined.requests_per_sec
+                  << " req/s, " << pipelined.syscalls_per_request << " syscalls/req; 大消息 "
+                  << (long)bulk.mb_per_sec << " MB/s" << std::endl;
+    }
+}
+
+static void bench_syscalls(int argc, char* argv[]) {
+    int num_conns = argc > 2 ? atoi(argv[2]) : 64;
+    int seconds = argc > 3 ? atoi(argv[3]) : 3;
+    int depth = argc > 4 ? atoi(argv[4]) : 4;
+    if (depth < 1) {
+        depth = 1;
+    }
+
+    const char* names[] = {"recv/send", "readv/writev"};
+    RoundResult results[2];
+    for (int i = 0; i < 2; i++) {
+        EpollServerOptions options;
+        options.vectored_io = (i == 1);
+        results[i] = run_round(19100 + i, options, num_conns, seconds, depth);
+    }
+
+    std::cerr << "连接数: " << num_conns << ", 每轮 " << seconds << " 秒, 流水线深度 " << depth << std::endl;
+    for (int i = 0; i < 2; i++) {
+        std::cerr << names[i] << ": " << (long)results[i].requests_per_sec << " req/s, "
+                  << results[i].syscalls_per_request << " syscalls/req" << std::endl;
+    }
+}
+
+int main(int argc, char* argv[]) {
+    const char* mode = argc > 1 ? argv[1] : "scaling";
+
+    // 压测期间只保留服务器的警告和错误日志，结果输出到stderr
+    Logger::set_level(LOG_LEVEL_WARN);
+    // 每轮结束时客户端直接关闭连接，服务器向已关闭的socket写入不能让进程退出
+    signal(SIGPIPE, SIG_IGN);
+
+    if (strcmp(mode, "syscalls") == 0) {
+        bench_syscalls(argc, argv);
+    } else if (strcmp(mode, "splice") == 0) {
+        bench_splice(argc, argv);
+    } else if (strcmp(mode, "transport") == 0) {
+        bench_transport(argc, argv);
+    } else if (strcmp(mode, "storm") == 0) {
+        bench_storm(argc, argv);
+    } else if (strcmp(mode, "tcp") == 0) {
+        bench_tcp(argc, argv);
+    } else if (strcmp(mode, "throttle-release") == 0) {
+        return bench_throttle_release(argc, argv) ? 0 : 1;
+    } else if (strcmp(mode, "offload-stop") == 0) {
+        bench_offload_stop(argc, argv);
+    } else if (strcmp(mode, "latency") == 0) {
+        bench_latency(argc, argv);
+#if __cplusplus >= 202002L
+    } else if (strcmp(mode, "coro") == 0) {
+        bench_coro(argc, argv);
+    } else if (strcmp(mode, "coflood") == 0) {
+        return bench_coflood(argc, argv) ? 0 : 1;
+#endif
+    } else {
+        bench_scaling(argc, argv);
+    }
+    return 0;
+}
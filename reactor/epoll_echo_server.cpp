@@ -1,310 +1,175 @@
 #include "epoll_echo_server.h"
 
-EpollEchoServer::EpollEchoServer(const std::string& host, int port) 
-    : host_(host), port_(port), server_fd_(-1), epoll_fd_(-1), running_(false) {
-}
-
-EpollEchoServer::~EpollEchoServer() {
-    stop();
-}
-
-void EpollEchoServer::set_non_blocking(int fd) {
-    int flags = fcntl(fd, F_GETFL, 0);
-    if (flags == -1) {
-        throw std::runtime_error("fcntl F_GETFL failed");
-    }
-    
-    if (fcntl(fd, F_SETFL, flags | O_NONBLOCK) == -1) {
-        throw std::runtime_error("fcntl F_SETFL failed");
-    }
-}
+#include <fcntl.h>
 
-void EpollEchoServer::add_epoll_event(int fd, uint32_t events) {
-    struct epoll_event ev;
-    ev.events = events;
-    ev.data.fd = fd;
-    
-    if (epoll_ctl(epoll_fd_, EPOLL_CTL_ADD, fd, &ev) == -1) {
-        throw std::runtime_error("epoll_ctl ADD failed for fd " + std::to_string(fd));
-    }
-}
+static const char* WELCOME_MESSAGE = "Welcome to Echo Server! Send any message and I'll echo it back.\n";
 
-void EpollEchoServer::modify_epoll_event(int fd, uint32_t events) {
-    struct epoll_event ev;
-    ev.events = events;
-    ev.data.fd = fd;
-    
-    if (epoll_ctl(epoll_fd_, EPOLL_CTL_MOD, fd, &ev) == -1) {
-        throw std::runtime_error("epoll_ctl MOD failed for fd " + std::to_string(fd));
+EpollEchoServer::EpollEchoServer(const std::string& host, int port, const EpollServerOptions& options) 
+    : host_(host), port_(port), options_(options), stop_requested_(false), drain_requested_(false),
+      drain_timeout_ms_(0), worker_pool_(nullptr) {
+    if (options_.num_threads < 1) {
+        options_.num_threads = 1;
     }
 }
 
-void EpollEchoServer::remove_epoll_event(int fd) {
-    if (epoll_ctl(epoll_fd_, EPOLL_CTL_DEL, fd, nullptr) == -1) {
-        // 不抛出异常，因为fd可能已经关闭
-        std::cerr << "epoll_ctl DEL failed for fd " << fd << ": " << strerror(errno) << std::endl;
+EpollEchoServer::~EpollEchoServer() {
+    stop();
+    if (worker_pool_) {
+        tpool_destroy(worker_pool_);
     }
 }
 
-void EpollEchoServer::setup_server_socket() {
-    // 创建服务器socket
-    server_fd_ = socket(AF_INET, SOCK_STREAM, 0);
-    if (server_fd_ == -1) {
-        throw std::runtime_error("Failed to create socket");
+bool EpollEchoServer::start() {
+    ReactorOptions loop_options = options_;
+    // 多reactor模式下每个线程绑定同一端口，由内核按连接做负载均衡
+    if (options_.num_threads > 1) {
+        loop_options.reuse_port = true;
+    }
+    if (options_.worker_threads > 0 && !worker_pool_) {
+        worker_pool_ = tpool_create(options_.worker_threads);
+        if (!worker_pool_) {
+            LOG_ERROR("启动服务器失败: 无法创建 " << options_.worker_threads << " 个工作线程");
+            return false;
+        }
+        LOG_INFO("请求交给 " << options_.worker_threads << " 个工作线程处理");
     }
+    loop_options.worker_pool = worker_pool_;
     
-    // 设置socket选项
-    int opt = 1;
-    if (setsockopt(server_fd_, SOL_SOCKET, SO_REUSEADDR, &opt, sizeof(opt)) < 0) {
-        close(server_fd_);
-        throw std::runtime_error("setsockopt failed");
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        
+        // 监听socket在这里统一创建(或使用接管来的)，交给各事件循环，便于之后整体交给新进程
+        std::vector<int> fds;
+        fds.swap(inherited_fds_);
+        try {
+            if (fds.empty()) {
+                SocketAddress addr = SocketAddress::resolve(host_, port_);
+                for (int i = 0; i < options_.num_threads; i++) {
+                    if (addr.is_unix() && i > 0) {
+                        // Unix域socket没有SO_REUSEPORT分流，各事件循环共享同一个监听socket；
+                        // 和其他socket一样close-on-exec，交给新进程的fd由--handover显式传递
+                        int fd = fcntl(fds[0], F_DUPFD_CLOEXEC, 0);
+                        if (fd == -1) {
+                            throw std::runtime_error(std::string("F_DUPFD_CLOEXEC failed: ") + strerror(errno));
+                        }
+                        fds.push_back(fd);
+                        continue;
+                    }
+                    fds.push_back(create_listen_socket(addr, loop_options.reuse_port, loop_options.listen_backlog));
+                }
+                LOG_INFO("Echo服务器启动在 " << addr.to_string());
+            } else {
+                LOG_INFO("接管 " << fds.size() << " 个监听socket");
+            }
+            for (int fd : fds) {
+                if (!options_.cpus.empty()) {
+                    // 每个事件循环独占一个CPU，连接状态在该CPU的NUMA节点上分配
+                    loop_options.cpu_affinity = {options_.cpus[loops_.size() % options_.cpus.size()]};
+                }
+                loops_.emplace_back(new EventLoop(host_, port_, loop_options, EchoHandler(WELCOME_MESSAGE)));
+                loops_.back()->adopt_listen_socket(fd);
+                // 创建期间收到的信号：事件循环启动后立即退出或进入平滑关闭
+                if (stop_requested_) {
+                    loops_.back()->stop();
+                } else if (drain_requested_) {
+                    loops_.back()->shutdown(drain_timeout_ms_);
+                }
+            }
+        } catch (const std::exception& e) {
+            // 已交给事件循环的fd由事件循环关闭
+            for (size_t i = loops_.size(); i < fds.size(); i++) {
+                close(fds[i]);
+            }
+            loops_.clear();
+            LOG_ERROR("启动服务器失败: " << e.what());
+            return false;
+        }
+        listen_fds_ = fds;
     }
     
-    // 绑定地址
-    sockaddr_in server_addr;
-    memset(&server_addr, 0, sizeof(server_addr));
-    server_addr.sin_family = AF_INET;
-    server_addr.sin_addr.s_addr = INADDR_ANY;
-    server_addr.sin_port = htons(port_);
-    
-    if (bind(server_fd_, (sockaddr*)&server_addr, sizeof(server_addr)) < 0) {
-        close(server_fd_);
-        throw std::runtime_error("Bind failed");
+    // 指标只是辅助功能，端点不可用时服务器照常运行
+    if (!options_.metrics_endpoint.empty()) {
+        metrics_server_.reset(new MetricsServer(options_.metrics_endpoint, [this]() { return metrics(); }));
+        try {
+            metrics_server_->start();
+        } catch (const std::exception& e) {
+            LOG_WARN("启动指标导出失败: " << e.what());
+            metrics_server_.reset();
+        }
     }
     
-    // 监听
-    if (listen(server_fd_, 128) < 0) {
-        close(server_fd_);
-        throw std::runtime_error("Listen failed");
+    if (loops_.size() == 1) {
+        loops_[0]->start();
+    } else {
+        LOG_INFO("启动 " << loops_.size() << " 个事件循环线程 (SO_REUSEPORT)");
+        
+        for (auto& loop : loops_) {
+            EventLoop* event_loop = loop.get();
+            loop_threads_.emplace_back([event_loop]() { event_loop->start(); });
+        }
+        for (auto& t : loop_threads_) {
+            t.join();
+        }
+        loop_threads_.clear();
     }
     
-    // 设置为非阻塞
-    set_non_blocking(server_fd_);
+    // 导出线程会访问事件循环，先停掉；它在mutex_内读取，不能持锁等待它退出
+    metrics_server_.reset();
     
-    std::cout << "Echo服务器启动在 " << host_ << ":" << port_ << std::endl;
-}
-
-void EpollEchoServer::setup_epoll() {
-    // 创建epoll实例
-    epoll_fd_ = epoll_create1(0);
-    if (epoll_fd_ == -1) {
-        throw std::runtime_error("epoll_create1 failed");
+    // 所有事件循环都已退出，汇总统计后释放
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        for (auto& loop : loops_) {
+            stats_ += loop->stats();
+        }
+        loops_.clear();
+        listen_fds_.clear();
     }
-    
-    // 添加服务器socket到epoll，监听读事件（水平触发）
-    add_epoll_event(server_fd_, EPOLLIN);
-    
-    std::cout << "Epoll初始化完成" << std::endl;
-}
 
-void EpollEchoServer::start() {
-    try {
-        setup_server_socket();
-        setup_epoll();
-        running_ = true;
-        event_loop();
-    } catch (const std::exception& e) {
-        std::cerr << "启动服务器失败: " << e.what() << std::endl;
-        stop();
+    // 事件循环退出前已等回所有任务，线程池中不再有引用事件循环的工作
+    if (worker_pool_) {
+        tpool_destroy(worker_pool_);
+        worker_pool_ = nullptr;
     }
+    return true;
 }
 
 void EpollEchoServer::stop() {
-    running_ = false;
-    
-    // 关闭所有客户端连接
-    for (auto& client : clients_) {
-        close(client.first);
+    // 只通知事件循环退出，fd由各事件循环在退出后关闭
+    std::lock_guard<std::mutex> lock(mutex_);
+    stop_requested_ = true;
+    for (auto& loop : loops_) {
+        loop->stop();
     }
-    clients_.clear();
-    
-    // 关闭epoll和服务器socket
-    if (epoll_fd_ != -1) {
-        close(epoll_fd_);
-        epoll_fd_ = -1;
-    }
-    
-    if (server_fd_ != -1) {
-        close(server_fd_);
-        server_fd_ = -1;
-    }
-    
-    std::cout << "服务器已关闭" << std::endl;
 }
 
-void EpollEchoServer::event_loop() {
-    struct epoll_event events[MAX_EVENTS];
-    
-    std::cout << "进入事件循环..." << std::endl;
-    
-    while (running_) {
-        // 等待事件，超时时间为1秒
-        int nfds = epoll_wait(epoll_fd_, events, MAX_EVENTS, 1000);
-        
-        if (nfds == -1) {
-            if (errno == EINTR) {
-                continue;  // 被信号中断，继续
-            }
-            std::cerr << "epoll_wait error: " << strerror(errno) << std::endl;
-            break;
-        }
-        
-        if (nfds == 0) {
-            // 超时
-            continue;
-        }
-        
-        // 处理所有就绪的事件
-        for (int i = 0; i < nfds; i++) {
-            int fd = events[i].data.fd;
-            uint32_t event_mask = events[i].events;
-            
-            // 检查错误事件
-            if (event_mask & (EPOLLERR | EPOLLHUP)) {
-                std::cerr << "Epoll错误事件发生在fd " << fd << std::endl;
-                close_connection(fd);
-                continue;
-            }
-            
-            if (fd == server_fd_) {
-                // 新连接
-                handle_accept();
-            } else {
-                // 客户端事件
-                if (event_mask & EPOLLIN) {
-                    handle_read(fd);
-                }
-                if (event_mask & EPOLLOUT) {
-                    handle_write(fd);
-                }
-            }
-        }
+void EpollEchoServer::shutdown(uint64_t drain_timeout_ms) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (!drain_requested_) {
+        drain_requested_ = true;
+        drain_timeout_ms_ = drain_timeout_ms;
     }
-}
-
-void EpollEchoServer::handle_accept() {
-    sockaddr_in client_addr;
-    socklen_t client_len = sizeof(client_addr);
-    
-    // 水平触发模式下，只需要接受一个连接
-    int client_fd = accept(server_fd_, (sockaddr*)&client_addr, &client_len);
-    
-    if (client_fd < 0) {
-        if (errno != EWOULDBLOCK && errno != EAGAIN) {
-            std::cerr << "Accept error: " << strerror(errno) << std::endl;
-        }
-        return;
+    for (auto& loop : loops_) {
+        loop->shutdown(drain_timeout_ms);
     }
-    
-    // 设置为非阻塞模式
-    set_non_blocking(client_fd);
-    
-    // 创建客户端数据
-    auto client_data = std::make_shared<ClientData>(client_fd, client_addr);
-    clients_[client_fd] = client_data;
-    
-    // 添加到epoll，监听读事件（水平触发）
-    add_epoll_event(client_fd, EPOLLIN);
-    
-    char client_ip[INET_ADDRSTRLEN];
-    inet_ntop(AF_INET, &client_addr.sin_addr, client_ip, INET_ADDRSTRLEN);
-    std::cout << "接受来自 " << client_ip << ":" << ntohs(client_addr.sin_port) 
-              << " 的新连接 (fd: " << client_fd << ")" << std::endl;
-    
-    // 发送欢迎消息
-    std::string welcome_msg = "Welcome to Echo Server! Send any message and I'll echo it back.\n";
-    client_data->send_buffer = welcome_msg;
-    
-    // 修改为监听读写事件，以便发送欢迎消息
-    modify_epoll_event(client_fd, EPOLLIN | EPOLLOUT);
 }
 
-void EpollEchoServer::handle_read(int client_fd) {
-    auto it = clients_.find(client_fd);
-    if (it == clients_.end()) {
-        return;
-    }
-    
-    auto& client_data = it->second;
-    char buffer[1024];
-    
-    ssize_t bytes_read = recv(client_fd, buffer, sizeof(buffer) - 1, 0);
-    
-    if (bytes_read > 0) {
-        buffer[bytes_read] = '\0';
-        client_data->recv_buffer.append(buffer, bytes_read);
-        
-        // 输出接收到的数据
-        std::cout << "从客户端 " << client_fd << " 收到 " << bytes_read 
-                  << " 字节: " << std::string(buffer, bytes_read);
-        
-        // Echo逻辑：将接收到的数据放入发送缓冲区
-        client_data->send_buffer.append(buffer, bytes_read);
-        
-        // 有数据要发送，确保监听写事件
-        if (!client_data->send_buffer.empty()) {
-            modify_epoll_event(client_fd, EPOLLIN | EPOLLOUT);
-        }
-        
-    } else if (bytes_read == 0) {
-        // 客户端关闭连接
-        std::cout << "客户端 " << client_fd << " 断开连接" << std::endl;
-        close_connection(client_fd);
-    } else {
-        if (errno != EWOULDBLOCK && errno != EAGAIN) {
-            std::cerr << "从客户端 " << client_fd << " 读取错误: " << strerror(errno) << std::endl;
-            close_connection(client_fd);
-        }
-    }
+std::vector<int> EpollEchoServer::listen_fds() {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return listen_fds_;
 }
 
-void EpollEchoServer::handle_write(int client_fd) {
-    auto it = clients_.find(client_fd);
-    if (it == clients_.end()) {
-        return;
-    }
-    
-    auto& client_data = it->second;
-    
-    if (client_data->send_buffer.empty()) {
-        // 没有数据要发送，只监听读事件
-        modify_epoll_event(client_fd, EPOLLIN);
-        return;
-    }
-    
-    ssize_t bytes_sent = send(client_fd, 
-                             client_data->send_buffer.data(), 
-                             client_data->send_buffer.size(), 
-                             0);
-    
-    if (bytes_sent > 0) {
-        std::cout << "向客户端 " << client_fd << " 发送 " << bytes_sent << " 字节" << std::endl;
-        client_data->send_buffer.erase(0, bytes_sent);
-        
-        // 如果所有数据都已发送，只监听读事件
-        if (client_data->send_buffer.empty()) {
-            modify_epoll_event(client_fd, EPOLLIN);
-        }
-    } else {
-        if (errno != EWOULDBLOCK && errno != EAGAIN) {
-            std::cerr << "向客户端 " << client_fd << " 发送错误: " << strerror(errno) << std::endl;
-            close_connection(client_fd);
-        }
-        // 如果是EWOULDBLOCK，保持当前的事件监听，下次再尝试发送
+std::vector<ReactorStats> EpollEchoServer::loop_stats() {
+    std::lock_guard<std::mutex> lock(mutex_);
+    std::vector<ReactorStats> stats;
+    for (auto& loop : loops_) {
+        stats.push_back(loop->stats());
     }
+    return stats;
 }
 
-void EpollEchoServer::close_connection(int client_fd) {
-    auto it = clients_.find(client_fd);
-    if (it != clients_.end()) {
-        char client_ip[INET_ADDRSTRLEN];
-        inet_ntop(AF_INET, &it->second->addr.sin_addr, client_ip, INET_ADDRSTRLEN);
-        std::cout << "关闭连接 " << client_ip << ":" << ntohs(it->second->addr.sin_port) 
-                  << " (fd: " << client_fd << ")" << std::endl;
-        
-        clients_.erase(it);
-    }
-    
-    remove_epoll_event(client_fd);
-    close(client_fd);
+std::string EpollEchoServer::metrics() {
+    MetricsWriter out;
+    write_reactor_metrics(out, loop_stats());
+    return out.text();
 }
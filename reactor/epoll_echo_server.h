@@ -1,61 +1,74 @@
 #ifndef EPOLL_ECHO_SERVER_H
 #define EPOLL_ECHO_SERVER_H
 
-#include <sys/epoll.h>
-#include <sys/socket.h>
-#include <netinet/in.h>
-#include <arpa/inet.h>
-#include <unistd.h>
-#include <fcntl.h>
-#include <errno.h>
-
-#include <iostream>
 #include <string>
 #include <vector>
-#include <map>
 #include <memory>
-#include <cstring>
+#include <mutex>
+#include <thread>
+
+#include "reactor.h"
+#include "echo_handler.h"
+
+// 服务器运行参数
+struct EpollServerOptions : ReactorOptions {
+    int num_threads = 1;        // 事件循环线程数，大于1时每个线程独立监听(SO_REUSEPORT)
+    int worker_threads = 0;     // 工作线程数，大于0时请求交给所有事件循环共享的线程池处理
+    std::string metrics_endpoint;   // 指标导出端点(TCP端口号或Unix域socket路径)，为空时不导出
+    std::vector<int> cpus;      // 非空时第i个事件循环线程绑定到cpus[i % cpus.size()]，覆盖cpu_affinity
+};
 
+// 基于epoll的Echo服务器，可以运行多个事件循环线程
 class EpollEchoServer {
 public:
-    EpollEchoServer(const std::string& host = "localhost", int port = 8888);
+    EpollEchoServer(const std::string& host = "localhost", int port = 8888,
+                    const EpollServerOptions& options = EpollServerOptions());
     ~EpollEchoServer();
     
-    void start();
+    // 阻塞运行直到所有事件循环退出；创建线程池或监听socket失败时返回false，不抛出异常
+    bool start();
+    // 以下函数可以在其他线程中调用；start()还在创建事件循环时调用也不会丢失，新建的事件循环立即按要求退出
     void stop();
+    // 平滑关闭：停止接受新连接，已有连接发完回复后关闭，超时强制关闭
+    void shutdown(uint64_t drain_timeout_ms);
+    
+    // 接管旧进程的监听socket，每个fd一个事件循环，必须在start()之前调用
+    void adopt_listen_sockets(const std::vector<int>& fds) { inherited_fds_ = fds; }
+    // 正在使用的监听socket，用于交给新进程；返回的fd仍归服务器所有
+    std::vector<int> listen_fds();
+    
+    // 所有事件循环的统计汇总，服务器停止后读取
+    const ReactorStats& stats() const { return stats_; }
+    // 运行中每个事件循环当前的统计，可以在其他线程中调用
+    std::vector<ReactorStats> loop_stats();
+    // loop_stats()的Prometheus文本格式
+    std::string metrics();
 
 private:
-    struct ClientData {
-        int fd;
-        sockaddr_in addr;
-        std::string recv_buffer;
-        std::string send_buffer;
-        
-        ClientData(int socket_fd, const sockaddr_in& client_addr) 
-            : fd(socket_fd), addr(client_addr) {}
-    };
-    
-    void setup_server_socket();
-    void setup_epoll();
-    void event_loop();
-    void handle_accept();
-    void handle_read(int client_fd);
-    void handle_write(int client_fd);
-    void close_connection(int client_fd);
-    void set_non_blocking(int fd);
-    void add_epoll_event(int fd, uint32_t events);
-    void modify_epoll_event(int fd, uint32_t events);
-    void remove_epoll_event(int fd);
+    typedef Reactor<EpollBackend, EchoHandler> EventLoop;
     
     std::string host_;
     int port_;
-    int server_fd_;
-    int epoll_fd_;
-    bool running_;
+    EpollServerOptions options_;
+    
+    // 每个事件循环拥有自己的监听socket、epoll实例和连接表；
+    // loops_在start()中创建和释放，mutex_保护它和listen_fds_不被stop()等并发访问
+    std::mutex mutex_;
+    std::vector<std::unique_ptr<EventLoop>> loops_;
+    std::vector<int> listen_fds_;
+    std::vector<int> inherited_fds_;
+    std::vector<std::thread> loop_threads_;
+    // 已经收到的stop()/shutdown()请求，由mutex_保护，应用到之后创建的事件循环上
+    bool stop_requested_;
+    bool drain_requested_;
+    uint64_t drain_timeout_ms_;
+    
+    // 工作线程池，所有事件循环退出后才能销毁
+    tpool_t* worker_pool_;
     
-    std::map<int, std::shared_ptr<ClientData>> clients_;
+    std::unique_ptr<MetricsServer> metrics_server_;
     
-    static const int MAX_EVENTS = 64;
+    ReactorStats stats_;
 };
 
 #endif // EPOLL_ECHO_SERVER_H
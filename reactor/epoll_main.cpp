@@ -1,37 +1,232 @@
 #include "epoll_echo_server.h"
+#include <sys/signalfd.h>
+#include <sys/eventfd.h>
+#include <poll.h>
 #include <csignal>
-#include <iostream>
+#include <algorithm>
 
-EpollEchoServer* g_server = nullptr;
+// 信号不再用异步信号处理函数处理：启动任何线程之前屏蔽SIGINT/SIGTERM，
+// 由主线程通过signalfd同步读取，在普通上下文中调用服务器接口。
+// 第一次信号平滑关闭，期间再收到信号立即退出。
+// --handover 路径: 在该Unix域socket上等待新进程连接，把监听socket交给它后平滑关闭；
+// --takeover 路径: 连接旧进程的交接socket，接管它的监听socket，不重新绑定端口。
 
-void signal_handler(int signal) {
-    std::cout << "\n接收到信号 " << signal << ", 正在关闭服务器..." << std::endl;
-    if (g_server) {
-        g_server->stop();
+int main(int argc, char* argv[]) {
+    // 必须在第一条日志之前屏蔽：日志的后台线程在第一次写日志时创建，会继承当前的信号掩码
+    // 被忽略的信号不会进入signalfd，从后台启动时继承来的SIG_IGN要先恢复
+    signal(SIGINT, SIG_DFL);
+    signal(SIGTERM, SIG_DFL);
+    sigset_t mask;
+    sigemptyset(&mask);
+    sigaddset(&mask, SIGINT);
+    sigaddset(&mask, SIGTERM);
+    pthread_sigmask(SIG_BLOCK, &mask, nullptr);
+
+    // 客户端断开后继续写入不应让进程退出，写错误由事件循环处理
+    signal(SIGPIPE, SIG_IGN);
+
+    LOG_INFO("启动 Epoll Echo 服务器...");
+
+    // 命令行参数: [线程数] [--et] [--vectored] [--idle 毫秒] [--workers 工作线程数]
+    //             [--frame raw|line|length] [--splice 字节数] [--drain 毫秒]
+    //             [--handover 路径] [--takeover 路径] [--backlog 长度] [--accept-batch 个数]
+    //             [--metrics 端口|unix:路径] [--host 地址] [--port 端口]
+    //             [--cpus CPU列表] [--numa-local] [--busy-poll 微秒]
+    //             [--tcp default|latency|throughput] [--defer-accept 秒]
+    // --host 可以是IPv4/IPv6地址、主机名或 unix:/路径，默认0.0.0.0
+    // --cpus 形如 0-3,8，第i个事件循环线程绑定到列表中第i个CPU上
+    EpollServerOptions options;
+    std::string host = "0.0.0.0";
+    int port = 8888;
+    uint64_t drain_timeout_ms = 5000;
+    std::string handover_path;
+    std::string takeover_path;
+    std::string tcp_profile = "default";
+    int defer_accept_s = 0;
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "--et") == 0) {
+            options.edge_triggered = true;
+        } else if (strcmp(argv[i], "--vectored") == 0) {
+            options.vectored_io = true;
+        } else if (strcmp(argv[i], "--idle") == 0 && i + 1 < argc) {
+            options.idle_timeout_ms = strtoull(argv[++i], nullptr, 10);
+        } else if (strcmp(argv[i], "--workers") == 0 && i + 1 < argc) {
+            options.worker_threads = atoi(argv[++i]);
+        } else if (strcmp(argv[i], "--splice") == 0 && i + 1 < argc) {
+            options.splice_threshold = strtoull(argv[++i], nullptr, 10);
+        } else if (strcmp(argv[i], "--frame") == 0 && i + 1 < argc) {
+            const char* mode = argv[++i];
+            if (strcmp(mode, "line") == 0) {
+                options.frame_mode = FrameMode::LINE;
+            } else if (strcmp(mode, "length") == 0) {
+                options.frame_mode = FrameMode::LENGTH_PREFIXED;
+            } else {
+                options.frame_mode = FrameMode::RAW;
+            }
+        } else if (strcmp(argv[i], "--backlog") == 0 && i + 1 < argc) {
+            options.listen_backlog = atoi(argv[++i]);
+        } else if (strcmp(argv[i], "--accept-batch") == 0 && i + 1 < argc) {
+            options.max_accepts_per_wakeup = std::max(1, atoi(argv[++i]));
+        } else if (strcmp(argv[i], "--host") == 0 && i + 1 < argc) {
+            host = argv[++i];
+        } else if (strcmp(argv[i], "--port") == 0 && i + 1 < argc) {
+            port = atoi(argv[++i]);
+        } else if (strcmp(argv[i], "--cpus") == 0 && i + 1 < argc) {
+            try {
+                options.cpus = parse_cpu_list(argv[++i]);
+            } catch (const std::exception& e) {
+                LOG_ERROR("错误: " << e.what());
+                return 1;
+            }
+        } else if (strcmp(argv[i], "--numa-local") == 0) {
+            options.numa_local = true;
+        } else if (strcmp(argv[i], "--busy-poll") == 0 && i + 1 < argc) {
+            options.busy_poll_us = strtoul(argv[++i], nullptr, 10);
+        } else if (strcmp(argv[i], "--tcp") == 0 && i + 1 < argc) {
+            tcp_profile = argv[++i];
+        } else if (strcmp(argv[i], "--defer-accept") == 0 && i + 1 < argc) {
+            defer_accept_s = atoi(argv[++i]);
+        } else if (strcmp(argv[i], "--metrics") == 0 && i + 1 < argc) {
+            options.metrics_endpoint = argv[++i];
+        } else if (strcmp(argv[i], "--drain") == 0 && i + 1 < argc) {
+            drain_timeout_ms = strtoull(argv[++i], nullptr, 10);
+        } else if (strcmp(argv[i], "--handover") == 0 && i + 1 < argc) {
+            handover_path = argv[++i];
+        } else if (strcmp(argv[i], "--takeover") == 0 && i + 1 < argc) {
+            takeover_path = argv[++i];
+        } else {
+            options.num_threads = atoi(argv[i]);
+        }
     }
-}
 
-int main() {
-    std::cout << "启动 Epoll Echo 服务器..." << std::endl;
-    
     try {
-        EpollEchoServer server("0.0.0.0", 8888);
-        g_server = &server;
-        
-        // 设置信号处理
-        signal(SIGINT, signal_handler);
-        signal(SIGTERM, signal_handler);
-        
-        std::cout << "服务器已启动，使用 telnet localhost 8888 进行测试" << std::endl;
-        std::cout << "按 Ctrl+C 停止服务器" << std::endl;
-        
-        server.start();
-        
+        options.tcp = TcpProfile::preset(tcp_profile);
+    } catch (const std::exception& e) {
+        LOG_ERROR("错误: " << e.what());
+        return 1;
+    }
+    // 服务器先发欢迎消息，开启后客户端要先发数据才会被accept
+    options.tcp.defer_accept_s = defer_accept_s;
+
+    int signal_fd = -1;
+    int done_fd = -1;
+    int handover_fd = -1;
+    int exit_code = 0;
+    try {
+        EpollEchoServer server(host, port, options);
+
+        if (!takeover_path.empty()) {
+            int sock = connect_unix_socket(takeover_path);
+            std::vector<int> fds;
+            try {
+                fds = recv_fds(sock);
+            } catch (...) {
+                close(sock);
+                throw;
+            }
+            close(sock);
+            server.adopt_listen_sockets(fds);
+        }
+
+        signal_fd = signalfd(-1, &mask, SFD_CLOEXEC);
+        done_fd = eventfd(0, EFD_CLOEXEC);
+        if (signal_fd == -1 || done_fd == -1) {
+            throw std::runtime_error(std::string("signalfd/eventfd failed: ") + strerror(errno));
+        }
+        if (!handover_path.empty()) {
+            handover_fd = create_unix_listen_socket(handover_path);
+        }
+
+        LOG_INFO("服务器已启动，使用 telnet localhost 8888 进行测试");
+        LOG_INFO("按 Ctrl+C 停止服务器");
+
+        // 服务器在单独的线程中运行，退出时通过done_fd通知主线程；
+        // 异常不能离开线程函数(否则std::terminate)，连同启动失败一起记下，join之后由主线程返回非0
+        bool server_ok = false;
+        std::thread server_thread([&server, &server_ok, done_fd]() {
+            try {
+                server_ok = server.start();
+            } catch (const std::exception& e) {
+                LOG_ERROR("服务器异常退出: " << e.what());
+            }
+            uint64_t one = 1;
+            ssize_t n = write(done_fd, &one, sizeof(one));
+            (void)n;
+        });
+
+        bool shutting_down = false;
+        while (true) {
+            pollfd pfds[3] = {{done_fd, POLLIN, 0}, {signal_fd, POLLIN, 0}, {handover_fd, POLLIN, 0}};
+            if (poll(pfds, handover_fd == -1 ? 2 : 3, -1) == -1) {
+                if (errno == EINTR) {
+                    continue;
+                }
+                LOG_ERROR("poll error: " << strerror(errno));
+                server.stop();
+                break;
+            }
+            if (pfds[0].revents & POLLIN) {
+                break;
+            }
+
+            if (pfds[1].revents & POLLIN) {
+                signalfd_siginfo info;
+                if (read(signal_fd, &info, sizeof(info)) != sizeof(info)) {
+                    continue;
+                }
+                if (!shutting_down) {
+                    LOG_INFO("接收到信号 " << info.ssi_signo << ", 开始平滑关闭");
+                    shutting_down = true;
+                    server.shutdown(drain_timeout_ms);
+                } else {
+                    LOG_INFO("再次接收到信号 " << info.ssi_signo << ", 立即退出");
+                    server.stop();
+                }
+            }
+
+            if (handover_fd != -1 && (pfds[2].revents & POLLIN)) {
+                int peer = accept4(handover_fd, nullptr, nullptr, SOCK_CLOEXEC);
+                if (peer == -1) {
+                    continue;
+                }
+                // 发送之前先删掉交接socket：新进程收到监听socket后可能在同一路径上创建自己的交接socket，
+                // 这时路径上不能还有一个在监听的socket，之后也不能再删掉新进程的
+                close(handover_fd);
+                unlink(handover_path.c_str());
+                handover_fd = -1;
+                try {
+                    send_fds(peer, server.listen_fds());
+                    LOG_INFO("监听socket已交给新进程，开始平滑关闭");
+                    shutting_down = true;
+                    server.shutdown(drain_timeout_ms);
+                } catch (const std::exception& e) {
+                    LOG_WARN("交接监听socket失败: " << e.what());
+                    try {
+                        handover_fd = create_unix_listen_socket(handover_path);
+                    } catch (const std::exception& err) {
+                        LOG_WARN("重新创建交接socket失败: " << err.what());
+                    }
+                }
+                close(peer);
+            }
+        }
+
+        server_thread.join();
+        if (!server_ok) {
+            exit_code = 1;
+        }
     } catch (const std::exception& e) {
-        std::cerr << "错误: " << e.what() << std::endl;
+        LOG_ERROR("错误: " << e.what());
         return 1;
     }
-    
-    std::cout << "服务器已关闭" << std::endl;
-    return 0;
+
+    if (handover_fd != -1) {
+        close(handover_fd);
+        unlink(handover_path.c_str());
+    }
+    close(signal_fd);
+    close(done_fd);
+
+    LOG_INFO("服务器已关闭");
+    return exit_code;
 }
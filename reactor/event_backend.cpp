@@ -0,0 +1,200 @@
+#include "event_backend.h"
+
+#include <string>
+#include <stdexcept>
+#include <cstring>
+
+#include "logger.h"
+
+SelectBackend::SelectBackend() : max_fd_(-1) {
+    FD_ZERO(&master_read_fds_);
+    FD_ZERO(&master_write_fds_);
+}
+
+void SelectBackend::open(bool edge_triggered) {
+    (void)edge_triggered;
+    FD_ZERO(&master_read_fds_);
+    FD_ZERO(&master_write_fds_);
+    max_fd_ = -1;
+}
+
+void SelectBackend::close() {
+    FD_ZERO(&master_read_fds_);
+    FD_ZERO(&master_write_fds_);
+    max_fd_ = -1;
+}
+
+bool SelectBackend::add(int fd, uint32_t events, uint64_t data) {
+    if (fd >= FD_SETSIZE) {
+        errno = EMFILE;
+        return false;
+    }
+    if ((size_t)fd >= data_.size()) {
+        data_.resize(fd + 1, 0);
+    }
+    modify(fd, events, data);
+    if (fd > max_fd_) {
+        max_fd_ = fd;
+    }
+    return true;
+}
+
+bool SelectBackend::modify(int fd, uint32_t events, uint64_t data) {
+    data_[fd] = data;
+    
+    if (events & EVENT_READ) {
+        FD_SET(fd, &master_read_fds_);
+    } else {
+        FD_CLR(fd, &master_read_fds_);
+    }
+    
+    if (events & EVENT_WRITE) {
+        FD_SET(fd, &master_write_fds_);
+    } else {
+        FD_CLR(fd, &master_write_fds_);
+    }
+    
+    // 暂停期间没有任何事件的fd可能被remove从max_fd_中移出，重新监听时要放回来
+    if (events != 0 && fd > max_fd_) {
+        max_fd_ = fd;
+    }
+    return true;
+}
+
+void SelectBackend::remove(int fd) {
+    // add失败的fd从未加入集合，超出FD_SETSIZE时FD_CLR会越界
+    if (fd >= FD_SETSIZE) {
+        return;
+    }
+    FD_CLR(fd, &master_read_fds_);
+    FD_CLR(fd, &master_write_fds_);
+    
+    // 更新max_fd_
+    while (max_fd_ >= 0 && !FD_ISSET(max_fd_, &master_read_fds_) && !FD_ISSET(max_fd_, &master_write_fds_)) {
+        max_fd_--;
+    }
+}
+
+int SelectBackend::wait(int timeout_ms, std::vector<ReadyEvent>& ready) {
+    struct timeval timeout;
+    timeout.tv_sec = timeout_ms / 1000;
+    timeout.tv_usec = (timeout_ms % 1000) * 1000;
+    
+    // 复制主文件描述符集合
+    fd_set read_fds = master_read_fds_;
+    fd_set write_fds = master_write_fds_;
+    
+    // 调试信息：显示当前监听的fd
+    LOG_TRACE("调用 select(), max_fd_ = " << max_fd_);
+    
+    stats_.wait_calls++;
+    int activity = select(max_fd_ + 1, &read_fds, &write_fds, nullptr, timeout_ms < 0 ? nullptr : &timeout);
+    if (activity <= 0) {
+        if (activity == 0 && timeout_ms > 0) {
+            LOG_TRACE("select() 超时，继续等待...");
+        }
+        return activity;
+    }
+    
+    LOG_TRACE("select() 返回 " << activity << " 个活跃事件");
+    
+    // 检查所有文件描述符
+    for (int fd = 0; fd <= max_fd_; fd++) {
+        uint32_t events = 0;
+        if (FD_ISSET(fd, &read_fds)) {
+            events |= EVENT_READ;
+        }
+        if (FD_ISSET(fd, &write_fds)) {
+            events |= EVENT_WRITE;
+        }
+        if (events) {
+            ready.push_back(ReadyEvent{data_[fd], events});
+        }
+    }
+    return (int)ready.size();
+}
+
+EpollBackend::EpollBackend() : epoll_fd_(-1), edge_triggered_(false) {
+}
+
+EpollBackend::~EpollBackend() {
+    close();
+}
+
+void EpollBackend::open(bool edge_triggered) {
+    // 创建epoll实例
+    epoll_fd_ = epoll_create1(0);
+    if (epoll_fd_ == -1) {
+        throw std::runtime_error("epoll_create1 failed");
+    }
+    edge_triggered_ = edge_triggered;
+    
+    LOG_INFO("Epoll初始化完成 (" << (edge_triggered_ ? "边沿触发" : "水平触发") << ")");
+}
+
+void EpollBackend::close() {
+    if (epoll_fd_ != -1) {
+        ::close(epoll_fd_);
+        epoll_fd_ = -1;
+    }
+}
+
+uint32_t EpollBackend::to_epoll_events(uint32_t events) const {
+    uint32_t epoll_events = edge_triggered_ ? (uint32_t)EPOLLET : 0u;
+    if (events & EVENT_READ) {
+        epoll_events |= EPOLLIN;
+    }
+    if (events & EVENT_WRITE) {
+        epoll_events |= EPOLLOUT;
+    }
+    return epoll_events;
+}
+
+bool EpollBackend::add(int fd, uint32_t events, uint64_t data) {
+    struct epoll_event ev;
+    ev.events = to_epoll_events(events);
+    ev.data.u64 = data;
+    
+    stats_.ctl_calls++;
+    return epoll_ctl(epoll_fd_, EPOLL_CTL_ADD, fd, &ev) == 0;
+}
+
+bool EpollBackend::modify(int fd, uint32_t events, uint64_t data) {
+    struct epoll_event ev;
+    ev.events = to_epoll_events(events);
+    ev.data.u64 = data;
+    
+    stats_.ctl_calls++;
+    return epoll_ctl(epoll_fd_, EPOLL_CTL_MOD, fd, &ev) == 0;
+}
+
+void EpollBackend::remove(int fd) {
+    stats_.ctl_calls++;
+    if (epoll_ctl(epoll_fd_, EPOLL_CTL_DEL, fd, nullptr) == -1) {
+        // 不抛出异常，因为fd可能已经关闭
+        LOG_WARN("epoll_ctl DEL failed for fd " << fd << ": " << strerror(errno));
+    }
+}
+
+int EpollBackend::wait(int timeout_ms, std::vector<ReadyEvent>& ready) {
+    struct epoll_event events[MAX_EVENTS];
+    
+    stats_.wait_calls++;
+    int nfds = epoll_wait(epoll_fd_, events, MAX_EVENTS, timeout_ms);
+    
+    for (int i = 0; i < nfds; i++) {
+        uint32_t mask = events[i].events;
+        uint32_t ready_events = 0;
+        if (mask & (EPOLLERR | EPOLLHUP)) {
+            ready_events |= EVENT_ERROR;
+        }
+        if (mask & EPOLLIN) {
+            ready_events |= EVENT_READ;
+        }
+        if (mask & EPOLLOUT) {
+            ready_events |= EVENT_WRITE;
+        }
+        ready.push_back(ReadyEvent{events[i].data.u64, ready_events});
+    }
+    return nfds;
+}
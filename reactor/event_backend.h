@@ -0,0 +1,102 @@
+#ifndef EVENT_BACKEND_H
+#define EVENT_BACKEND_H
+
+#include <sys/select.h>
+#include <sys/epoll.h>
+#include <unistd.h>
+#include <errno.h>
+
+#include <cstdint>
+#include <vector>
+
+#include "metrics.h"
+
+// Reactor的事件多路分离后端
+// 每个后端提供相同的成员函数，作为Reactor的模板参数在编译期选定，没有虚函数调用:
+//   void open(bool edge_triggered);
+//   void close();
+//   bool add(int fd, uint32_t events, uint64_t data);      // data在就绪时原样返回，失败时返回false并设置errno
+//   bool modify(int fd, uint32_t events, uint64_t data);   // 失败约定同add
+//   void remove(int fd);
+//   void release(int fd);          // fd即将被close，只在必要时从后端去掉
+//   int wait(int timeout_ms, std::vector<ReadyEvent>& ready);   // 返回就绪个数，出错返回-1
+//   const BackendStats& stats() const;
+
+// 事件类型，由各个后端翻译成自己的表示
+enum : uint32_t {
+    EVENT_READ = 1u << 0,
+    EVENT_WRITE = 1u << 1,
+    EVENT_ERROR = 1u << 2,
+};
+
+struct ReadyEvent {
+    uint64_t data;
+    uint32_t events;
+};
+
+// 后端系统调用计数，事件循环运行时其他线程也可以读取
+struct BackendStats {
+    Counter wait_calls;
+    Counter ctl_calls;      // 只统计真正的系统调用，select的FD_SET不计入
+};
+
+// select后端：受FD_SETSIZE限制，每次等待都要复制fd集合并线性扫描到max_fd
+class SelectBackend {
+public:
+    static constexpr bool supports_edge_triggered = false;
+    static constexpr const char* name = "select";
+    
+    SelectBackend();
+    
+    void open(bool edge_triggered);
+    void close();
+    // fd超过FD_SETSIZE时返回false，errno为EMFILE
+    bool add(int fd, uint32_t events, uint64_t data);
+    bool modify(int fd, uint32_t events, uint64_t data);
+    void remove(int fd);
+    void release(int fd) { remove(fd); }
+    int wait(int timeout_ms, std::vector<ReadyEvent>& ready);
+    
+    const BackendStats& stats() const { return stats_; }
+
+private:
+    fd_set master_read_fds_;
+    fd_set master_write_fds_;
+    int max_fd_;
+    std::vector<uint64_t> data_;    // 按fd索引的事件数据
+    BackendStats stats_;
+};
+
+// epoll后端：就绪列表由内核维护，支持边沿触发
+class EpollBackend {
+public:
+    static constexpr bool supports_edge_triggered = true;
+    static constexpr const char* name = "epoll";
+    
+    EpollBackend();
+    ~EpollBackend();
+    
+    void open(bool edge_triggered);
+    void close();
+    // epoll_ctl失败(例如超过max_user_watches或内存不足)时返回false，errno由内核设置
+    bool add(int fd, uint32_t events, uint64_t data);
+    bool modify(int fd, uint32_t events, uint64_t data);
+    void remove(int fd);
+    // 最后一个引用被close时内核自动把fd从epoll中去掉，省掉一次EPOLL_CTL_DEL；
+    // 被dup或跨进程共享的fd(例如交接的监听socket)仍然要用remove
+    void release(int fd) { (void)fd; }
+    int wait(int timeout_ms, std::vector<ReadyEvent>& ready);
+    
+    const BackendStats& stats() const { return stats_; }
+
+private:
+    uint32_t to_epoll_events(uint32_t events) const;
+    
+    int epoll_fd_;
+    bool edge_triggered_;
+    BackendStats stats_;
+    
+    static const int MAX_EVENTS = 64;
+};
+
+#endif // EVENT_BACKEND_H
@@ -0,0 +1,90 @@
+#include "frame_codec.h"
+
+FrameCodec::FrameCodec(FrameMode mode, size_t max_frame_size)
+    : mode_(mode), max_frame_size_(max_frame_size), scanned_(0), frame_size_(0), failed_(false) {
+}
+
+FrameCodec::Status FrameCodec::next(const ChunkBuffer& in, std::string_view& frame) {
+    if (failed_) {
+        return TOO_LARGE;
+    }
+
+    switch (mode_) {
+    case FrameMode::RAW:
+        if (in.empty()) {
+            return NEED_MORE;
+        }
+        frame_size_ = in.size();
+        frame = view(in, 0, frame_size_);
+        return FRAME;
+
+    case FrameMode::LINE: {
+        size_t pos = in.find('\n', scanned_);
+        if (pos == ChunkBuffer::npos) {
+            scanned_ = in.size();
+            return scanned_ > max_frame_size_ ? fail() : NEED_MORE;
+        }
+        if (pos > max_frame_size_) {
+            return fail();
+        }
+        scanned_ = 0;
+        frame_size_ = pos + 1;
+        frame = view(in, 0, pos);
+        return FRAME;
+    }
+
+    case FrameMode::LENGTH_PREFIXED: {
+        if (in.size() < HEADER_SIZE) {
+            return NEED_MORE;
+        }
+        unsigned char header[HEADER_SIZE];
+        in.copy_to(0, (char*)header, HEADER_SIZE);
+        size_t len = ((size_t)header[0] << 24) | ((size_t)header[1] << 16)
+                     | ((size_t)header[2] << 8) | (size_t)header[3];
+        if (len > max_frame_size_) {
+            return fail();
+        }
+        if (in.size() < HEADER_SIZE + len) {
+            return NEED_MORE;
+        }
+        frame_size_ = HEADER_SIZE + len;
+        frame = view(in, HEADER_SIZE, len);
+        return FRAME;
+    }
+    }
+    return NEED_MORE;
+}
+
+void FrameCodec::pop(ChunkBuffer& in) {
+    in.consume(frame_size_);
+    frame_size_ = 0;
+}
+
+void FrameCodec::encode(ChunkBuffer& out, std::string_view payload) const {
+    if (mode_ == FrameMode::LENGTH_PREFIXED) {
+        char header[HEADER_SIZE] = {
+            (char)(payload.size() >> 24), (char)(payload.size() >> 16),
+            (char)(payload.size() >> 8), (char)payload.size(),
+        };
+        out.append(header, HEADER_SIZE);
+    }
+    out.append(payload.data(), payload.size());
+    if (mode_ == FrameMode::LINE) {
+        out.append("\n", 1);
+    }
+}
+
+std::string_view FrameCodec::view(const ChunkBuffer& in, size_t offset, size_t len) {
+    if (offset + len <= in.front_size()) {
+        return std::string_view(in.front_data() + offset, len);
+    }
+    // 跨越数据块边界，拼到暂存区
+    scratch_.resize(len);
+    in.copy_to(offset, &scratch_[0], len);
+    return std::string_view(scratch_.data(), len);
+}
+
+FrameCodec::Status FrameCodec::fail() {
+    failed_ = true;
+    return TOO_LARGE;
+}
@@ -0,0 +1,58 @@
+#ifndef FRAME_CODEC_H
+#define FRAME_CODEC_H
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <string_view>
+
+#include "chunk_buffer.h"
+
+// 分帧方式
+enum class FrameMode {
+    RAW,                // 不分帧，接收缓冲区里已有的数据整体作为一条消息
+    LINE,               // 以'\n'结尾，消息体不含'\n'
+    LENGTH_PREFIXED,    // 4字节大端长度头 + 消息体
+};
+
+// 消息分帧器，每个连接一个
+// 直接在接收缓冲区上解析：消息位于头块内时返回的frame指向缓冲区本身，不拷贝；
+// 只有跨越数据块边界的消息才拷贝到内部暂存区拼成连续内存。
+// 按行分帧时记住已扫描过的位置，半行数据不会在每次读到新数据时被重复扫描。
+class FrameCodec {
+public:
+    enum Status {
+        FRAME,          // 得到一条完整消息
+        NEED_MORE,      // 数据不足一条消息
+        TOO_LARGE,      // 消息超过max_frame_size，连接应当关闭
+    };
+
+    static const size_t HEADER_SIZE = 4;
+
+    explicit FrameCodec(FrameMode mode = FrameMode::RAW, size_t max_frame_size = 1024 * 1024);
+
+    // 解析下一条消息，frame在pop()之前或缓冲区被修改之前有效
+    Status next(const ChunkBuffer& in, std::string_view& frame);
+    // 从缓冲区消费掉上一次next()返回的消息(连同分隔符或长度头)
+    void pop(ChunkBuffer& in);
+
+    // 把一条消息按当前分帧方式编码后追加到out
+    void encode(ChunkBuffer& out, std::string_view payload) const;
+
+    FrameMode mode() const { return mode_; }
+    bool failed() const { return failed_; }
+
+private:
+    // 取缓冲区中从offset开始的len字节作为连续内存
+    std::string_view view(const ChunkBuffer& in, size_t offset, size_t len);
+    Status fail();
+
+    FrameMode mode_;
+    size_t max_frame_size_;
+    size_t scanned_;        // 按行分帧时已确认不含'\n'的字节数
+    size_t frame_size_;     // 待pop的字节数
+    bool failed_;
+    std::string scratch_;   // 跨块消息的暂存区
+};
+
+#endif // FRAME_CODEC_H
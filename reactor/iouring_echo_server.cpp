@@ -0,0 +1,507 @@
+#include "iouring_echo_server.h"
+
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <fcntl.h>
+#include <signal.h>
+#include <time.h>
+
+static int io_uring_setup(unsigned entries, io_uring_params* params) {
+    return (int)syscall(__NR_io_uring_setup, entries, params);
+}
+
+static int io_uring_enter(int ring_fd, unsigned to_submit, unsigned min_complete,
+                          unsigned flags, void* arg, size_t arg_size) {
+    return (int)syscall(__NR_io_uring_enter, ring_fd, to_submit, min_complete, flags, arg, arg_size);
+}
+
+static int io_uring_register(int ring_fd, unsigned opcode, void* arg, unsigned nr_args) {
+    return (int)syscall(__NR_io_uring_register, ring_fd, opcode, arg, nr_args);
+}
+
+static uint64_t make_user_data(uint64_t op, uint64_t id) {
+    return (op << 56) | id;
+}
+
+IoUringEchoServer::IoUringEchoServer(const std::string& host, int port)
+    : host_(host), port_(port), server_fd_(-1), running_(false),
+      ring_fd_(-1), ring_ptr_(nullptr), ring_size_(0), sqes_(nullptr), sqes_size_(0),
+      sq_head_(nullptr), sq_tail_(nullptr), sq_mask_(0), sq_entries_(0), sqe_tail_(0),
+      cq_head_(nullptr), cq_tail_(nullptr), cq_mask_(0), cqes_(nullptr),
+      buf_ring_(nullptr), buffers_(nullptr), buf_tail_(0),
+      next_client_id_(1), accept_armed_(false), stop_requested_(false) {
+}
+
+IoUringEchoServer::~IoUringEchoServer() {
+    stop();
+    cleanup();
+}
+
+bool IoUringEchoServer::setup_ring() {
+    io_uring_params params;
+    memset(&params, 0, sizeof(params));
+    // SINGLE_ISSUER需要6.0以上内核，同时也保证了multishot recv可用
+    params.flags = IORING_SETUP_SINGLE_ISSUER;
+
+    ring_fd_ = io_uring_setup(RING_ENTRIES, &params);
+    if (ring_fd_ < 0) {
+        LOG_WARN("io_uring_setup失败: " << strerror(errno));
+        ring_fd_ = -1;
+        return false;
+    }
+
+    if (!(params.features & IORING_FEAT_SINGLE_MMAP) || !(params.features & IORING_FEAT_EXT_ARG)) {
+        LOG_WARN("io_uring缺少SINGLE_MMAP/EXT_ARG特性");
+        return false;
+    }
+
+    // 提交队列和完成队列共用一次mmap
+    size_t sq_size = params.sq_off.array + params.sq_entries * sizeof(unsigned);
+    size_t cq_size = params.cq_off.cqes + params.cq_entries * sizeof(io_uring_cqe);
+    ring_size_ = std::max(sq_size, cq_size);
+    ring_ptr_ = mmap(nullptr, ring_size_, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE,
+                     ring_fd_, IORING_OFF_SQ_RING);
+    if (ring_ptr_ == MAP_FAILED) {
+        ring_ptr_ = nullptr;
+        return false;
+    }
+
+    sqes_size_ = params.sq_entries * sizeof(io_uring_sqe);
+    void* sqes = mmap(nullptr, sqes_size_, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE,
+                      ring_fd_, IORING_OFF_SQES);
+    if (sqes == MAP_FAILED) {
+        return false;
+    }
+    sqes_ = (io_uring_sqe*)sqes;
+
+    char* ring = (char*)ring_ptr_;
+    sq_head_ = (unsigned*)(ring + params.sq_off.head);
+    sq_tail_ = (unsigned*)(ring + params.sq_off.tail);
+    sq_mask_ = *(unsigned*)(ring + params.sq_off.ring_mask);
+    sq_entries_ = params.sq_entries;
+    sqe_tail_ = *sq_tail_;
+    cq_head_ = (unsigned*)(ring + params.cq_off.head);
+    cq_tail_ = (unsigned*)(ring + params.cq_off.tail);
+    cq_mask_ = *(unsigned*)(ring + params.cq_off.ring_mask);
+    cqes_ = (io_uring_cqe*)(ring + params.cq_off.cqes);
+
+    // 提交队列索引数组固定为一一对应，之后只需要推进tail
+    unsigned* sq_array = (unsigned*)(ring + params.sq_off.array);
+    for (unsigned i = 0; i < params.sq_entries; i++) {
+        sq_array[i] = i;
+    }
+
+    return setup_buffer_ring();
+}
+
+bool IoUringEchoServer::setup_buffer_ring() {
+    size_t ring_bytes = BUF_RING_ENTRIES * sizeof(io_uring_buf);
+    void* ring = mmap(nullptr, ring_bytes, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    if (ring == MAP_FAILED) {
+        return false;
+    }
+    // 按io_uring_buf数组访问：C++下io_uring_buf_ring的柔性数组成员布局与内核不一致，
+    // 环的tail与bufs[0].resv共用同一位置
+    memset(ring, 0, ring_bytes);
+    buf_ring_ = (io_uring_buf*)ring;
+    buffers_ = new char[BUF_RING_ENTRIES * BUF_SIZE];
+
+    io_uring_buf_reg reg;
+    memset(&reg, 0, sizeof(reg));
+    reg.ring_addr = (uint64_t)buf_ring_;
+    reg.ring_entries = BUF_RING_ENTRIES;
+    reg.bgid = BUF_GROUP;
+    if (io_uring_register(ring_fd_, IORING_REGISTER_PBUF_RING, &reg, 1) < 0) {
+        LOG_WARN("注册provided buffer ring失败: " << strerror(errno));
+        return false;
+    }
+
+    for (unsigned i = 0; i < BUF_RING_ENTRIES; i++) {
+        recycle_buffer((unsigned short)i);
+    }
+    return true;
+}
+
+void IoUringEchoServer::recycle_buffer(unsigned short bid) {
+    // 注意不能整体覆盖io_uring_buf，否则会改写bufs[0].resv位置上的tail
+    io_uring_buf* buf = &buf_ring_[buf_tail_ & (BUF_RING_ENTRIES - 1)];
+    buf->addr = (uint64_t)(buffers_ + (size_t)bid * BUF_SIZE);
+    buf->len = BUF_SIZE;
+    buf->bid = bid;
+    buf_tail_++;
+    __atomic_store_n(&buf_ring_[0].resv, buf_tail_, __ATOMIC_RELEASE);
+}
+
+void IoUringEchoServer::destroy_ring() {
+    // 关闭ring fd会取消所有未完成的请求
+    if (ring_fd_ != -1) {
+        close(ring_fd_);
+        ring_fd_ = -1;
+    }
+    if (sqes_) {
+        munmap(sqes_, sqes_size_);
+        sqes_ = nullptr;
+    }
+    if (ring_ptr_) {
+        munmap(ring_ptr_, ring_size_);
+        ring_ptr_ = nullptr;
+    }
+    if (buf_ring_) {
+        munmap(buf_ring_, BUF_RING_ENTRIES * sizeof(io_uring_buf));
+        buf_ring_ = nullptr;
+    }
+    delete[] buffers_;
+    buffers_ = nullptr;
+}
+
+io_uring_sqe* IoUringEchoServer::get_sqe() {
+    unsigned head = __atomic_load_n(sq_head_, __ATOMIC_ACQUIRE);
+    if (sqe_tail_ - head >= sq_entries_) {
+        // 提交队列已满，先把已有的提交给内核
+        submit_and_wait(0);
+        head = __atomic_load_n(sq_head_, __ATOMIC_ACQUIRE);
+        if (sqe_tail_ - head >= sq_entries_) {
+            throw std::runtime_error("io_uring submission queue full");
+        }
+    }
+
+    io_uring_sqe* sqe = &sqes_[sqe_tail_ & sq_mask_];
+    sqe_tail_++;
+    memset(sqe, 0, sizeof(*sqe));
+    return sqe;
+}
+
+int IoUringEchoServer::submit_and_wait(unsigned wait_nr) {
+    __atomic_store_n(sq_tail_, sqe_tail_, __ATOMIC_RELEASE);
+    unsigned to_submit = sqe_tail_ - __atomic_load_n(sq_head_, __ATOMIC_ACQUIRE);
+
+    if (wait_nr == 0) {
+        return io_uring_enter(ring_fd_, to_submit, 0, 0, nullptr, 0);
+    }
+
+    // 最多等待1秒，以便及时响应stop()
+    struct __kernel_timespec ts;
+    ts.tv_sec = 1;
+    ts.tv_nsec = 0;
+    io_uring_getevents_arg arg;
+    memset(&arg, 0, sizeof(arg));
+    arg.sigmask_sz = _NSIG / 8;
+    arg.ts = (uint64_t)&ts;
+    return io_uring_enter(ring_fd_, to_submit, wait_nr,
+                          IORING_ENTER_GETEVENTS | IORING_ENTER_EXT_ARG, &arg, sizeof(arg));
+}
+
+void IoUringEchoServer::setup_server_socket() {
+    SocketAddress addr = SocketAddress::resolve(host_, port_);
+    server_fd_ = create_listen_socket(addr);
+    LOG_INFO("Echo服务器启动在 " << addr.to_string() << " (io_uring)");
+}
+
+bool IoUringEchoServer::start() {
+    if (!setup_ring()) {
+        LOG_WARN("io_uring不可用，退回到epoll");
+        destroy_ring();
+        EpollEchoServer* fallback;
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            fallback_.reset(new EpollEchoServer(host_, port_));
+            fallback = fallback_.get();
+            // 之前收到的stop()由EpollEchoServer记住，事件循环建好后立即退出
+            if (stop_requested_) {
+                fallback->stop();
+            }
+        }
+        return fallback->start();
+    }
+
+    bool ok = true;
+    try {
+        setup_server_socket();
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            running_ = !stop_requested_;
+        }
+        event_loop();
+    } catch (const std::exception& e) {
+        LOG_ERROR("启动服务器失败: " << e.what());
+        ok = false;
+    }
+    cleanup();
+    return ok;
+}
+
+void IoUringEchoServer::stop() {
+    std::lock_guard<std::mutex> lock(mutex_);
+    stop_requested_ = true;
+    running_ = false;
+    if (fallback_) {
+        fallback_->stop();
+    }
+}
+
+void IoUringEchoServer::cleanup() {
+    // 先销毁ring取消所有未完成的请求，之后才能安全地释放连接和缓冲区
+    destroy_ring();
+
+    for (auto& client : clients_) {
+        close(client.second->fd);
+    }
+    clients_.clear();
+    flush_ids_.clear();
+    accept_armed_ = false;
+
+    if (server_fd_ != -1) {
+        close(server_fd_);
+        server_fd_ = -1;
+        LOG_INFO("服务器已关闭");
+    }
+}
+
+void IoUringEchoServer::event_loop() {
+    LOG_INFO("进入事件循环...");
+
+    arm_accept();
+
+    while (running_) {
+        // 一次系统调用完成提交和等待
+        int ret = submit_and_wait(1);
+        if (ret < 0 && errno != EINTR && errno != ETIME) {
+            LOG_ERROR("io_uring_enter error: " << strerror(errno));
+            break;
+        }
+
+        // 处理所有完成事件
+        unsigned head = *cq_head_;
+        unsigned tail = __atomic_load_n(cq_tail_, __ATOMIC_ACQUIRE);
+        while (head != tail) {
+            io_uring_cqe cqe = cqes_[head & cq_mask_];
+            head++;
+            __atomic_store_n(cq_head_, head, __ATOMIC_RELEASE);
+            handle_completion(cqe.user_data, cqe.res, cqe.flags);
+        }
+
+        // 本批次产生的回显统一提交
+        std::vector<uint64_t> flush;
+        flush.swap(flush_ids_);
+        for (uint64_t id : flush) {
+            auto it = clients_.find(id);
+            if (it != clients_.end()) {
+                it->second->flush_queued = false;
+                flush_sends(*it->second);
+            }
+        }
+
+        if (!accept_armed_ && running_) {
+            arm_accept();
+        }
+    }
+}
+
+void IoUringEchoServer::handle_completion(uint64_t user_data, int res, unsigned flags) {
+    uint64_t op = user_data >> 56;
+    uint64_t id = user_data & ((1ULL << 56) - 1);
+
+    if (op == OP_ACCEPT) {
+        handle_accept(res, flags);
+        return;
+    }
+    if (op == OP_CANCEL) {
+        // recv可能已经自己结束(-ENOENT/-EALREADY)，结果以recv的最后一个完成事件为准
+        return;
+    }
+
+    auto it = clients_.find(id);
+    if (it == clients_.end()) {
+        // 连接已经释放，只需要归还缓冲区
+        if (flags & IORING_CQE_F_BUFFER) {
+            recycle_buffer((unsigned short)(flags >> IORING_CQE_BUFFER_SHIFT));
+        }
+        return;
+    }
+
+    if (op == OP_RECV) {
+        handle_recv(*it->second, res, flags);
+    } else if (op == OP_SEND) {
+        handle_send(*it->second, res);
+    }
+}
+
+void IoUringEchoServer::arm_accept() {
+    io_uring_sqe* sqe = get_sqe();
+    sqe->opcode = IORING_OP_ACCEPT;
+    sqe->fd = server_fd_;
+    sqe->ioprio = IORING_ACCEPT_MULTISHOT;
+    sqe->accept_flags = SOCK_CLOEXEC;
+    sqe->user_data = make_user_data(OP_ACCEPT, 0);
+    accept_armed_ = true;
+}
+
+void IoUringEchoServer::arm_recv(ClientData& client) {
+    io_uring_sqe* sqe = get_sqe();
+    sqe->opcode = IORING_OP_RECV;
+    sqe->fd = client.fd;
+    sqe->ioprio = IORING_RECV_MULTISHOT;
+    sqe->flags = IOSQE_BUFFER_SELECT;
+    sqe->buf_group = BUF_GROUP;
+    sqe->user_data = make_user_data(OP_RECV, client.id);
+    client.recv_armed = true;
+}
+
+void IoUringEchoServer::pause_recv(ClientData& client) {
+    client.recv_paused = true;
+    if (!client.recv_armed) {
+        return;
+    }
+    // multishot recv不会自己停下，取消后以-ECANCELED结束；取消之前已经收到的数据照常完成
+    io_uring_sqe* sqe = get_sqe();
+    sqe->opcode = IORING_OP_ASYNC_CANCEL;
+    sqe->fd = -1;
+    sqe->addr = make_user_data(OP_RECV, client.id);
+    sqe->user_data = make_user_data(OP_CANCEL, client.id);
+}
+
+void IoUringEchoServer::flush_sends(ClientData& client) {
+    // 同一时间每个连接只有一条发送链在执行，保证数据顺序
+    if (client.closing || client.sends_in_flight > 0 || client.send_buffer.empty()) {
+        return;
+    }
+
+    struct iovec iov[MAX_LINKED_SENDS];
+    int count = client.send_buffer.fill_iovec(iov, MAX_LINKED_SENDS);
+    for (int i = 0; i < count; i++) {
+        io_uring_sqe* sqe = get_sqe();
+        sqe->opcode = IORING_OP_SEND;
+        sqe->fd = client.fd;
+        sqe->addr = (uint64_t)iov[i].iov_base;
+        sqe->len = iov[i].iov_len;
+        sqe->msg_flags = MSG_NOSIGNAL | MSG_WAITALL;
+        sqe->user_data = make_user_data(OP_SEND, client.id);
+        // 除最后一个外都链接到下一个，前一个发送不完整时后续的会被取消
+        if (i + 1 < count) {
+            sqe->flags = IOSQE_IO_LINK;
+        }
+    }
+    client.sends_in_flight = count;
+}
+
+void IoUringEchoServer::handle_accept(int res, unsigned flags) {
+    if (!(flags & IORING_CQE_F_MORE)) {
+        // multishot accept已终止，本轮结束后重新提交
+        accept_armed_ = false;
+    }
+
+    if (res < 0) {
+        LOG_ERROR("Accept error: " << strerror(-res));
+        return;
+    }
+
+    int client_fd = res;
+    SocketAddress client_addr;
+    getpeername(client_fd, client_addr.data(), client_addr.size_ptr());
+
+    uint64_t id = next_client_id_++;
+    ClientData* client = new ClientData(client_fd, id, client_addr, pool_);
+    clients_[id].reset(client);
+
+    LOG_DEBUG("接受来自 " << format_address(client_addr) << " 的新连接 (fd: " << client_fd << ")");
+
+    arm_recv(*client);
+
+    // 发送欢迎消息
+    client->send_buffer.append("Welcome to Echo Server! Send any message and I'll echo it back.\n");
+    flush_sends(*client);
+}
+
+void IoUringEchoServer::handle_recv(ClientData& client, int res, unsigned flags) {
+    if (res > 0 && (flags & IORING_CQE_F_BUFFER)) {
+        unsigned short bid = (unsigned short)(flags >> IORING_CQE_BUFFER_SHIFT);
+
+        if (!client.closing) {
+            LOG_TRACE("从客户端 " << client.fd << " 收到 " << res << " 字节");
+
+            // Echo逻辑：复制到发送缓冲区后立即归还内核缓冲区，慢连接不会占住缓冲区环
+            client.send_buffer.append(buffers_ + (size_t)bid * BUF_SIZE, res);
+            if (!client.flush_queued) {
+                client.flush_queued = true;
+                flush_ids_.push_back(client.id);
+            }
+            // 对端只发不收时回显堆在发送缓冲区，超过高水位停止接收
+            if (!client.recv_paused && client.send_buffer.size() >= SEND_HIGH_WATER_MARK) {
+                pause_recv(client);
+            }
+        }
+        recycle_buffer(bid);
+    }
+
+    if (flags & IORING_CQE_F_MORE) {
+        return;
+    }
+
+    // multishot recv已终止
+    client.recv_armed = false;
+
+    if (client.closing) {
+        release_if_idle(client);
+    } else if (res == 0) {
+        LOG_DEBUG("客户端 " << client.fd << " 断开连接");
+        close_connection(client);
+    } else if (res < 0 && res != -ENOBUFS && res != -ECANCELED) {
+        LOG_WARN("从客户端 " << client.fd << " 读取错误: " << strerror(-res));
+        close_connection(client);
+    } else if (!client.recv_paused) {
+        // 缓冲区暂时用完、内核主动结束了multishot，或者取消完成前已经恢复，重新提交
+        arm_recv(client);
+    }
+}
+
+void IoUringEchoServer::handle_send(ClientData& client, int res) {
+    client.sends_in_flight--;
+
+    if (res > 0) {
+        LOG_TRACE("向客户端 " << client.fd << " 发送 " << res << " 字节");
+        client.send_buffer.consume(res);
+    } else if (res < 0 && res != -ECANCELED && !client.closing) {
+        LOG_WARN("向客户端 " << client.fd << " 发送错误: " << strerror(-res));
+        close_connection(client);
+        return;
+    }
+
+    if (client.sends_in_flight > 0) {
+        return;
+    }
+
+    if (client.closing) {
+        release_if_idle(client);
+        return;
+    }
+    // 发送缓冲区降到低水位以下，恢复接收；取消还没完成时由recv结束时重新提交
+    if (client.recv_paused && client.send_buffer.size() <= SEND_LOW_WATER_MARK) {
+        client.recv_paused = false;
+        if (!client.recv_armed) {
+            arm_recv(client);
+        }
+    }
+    // 整条链完成(或因发送不完整被截断)，继续发送剩余数据
+    flush_sends(client);
+}
+
+void IoUringEchoServer::close_connection(ClientData& client) {
+    if (client.closing) {
+        return;
+    }
+    client.closing = true;
+
+    LOG_DEBUG("关闭连接 " << format_address(client.addr) << " (fd: " << client.fd << ")");
+
+    // 先shutdown让未完成的recv/send尽快结束，全部完成后再关闭fd并释放连接
+    shutdown(client.fd, SHUT_RDWR);
+    release_if_idle(client);
+}
+
+void IoUringEchoServer::release_if_idle(ClientData& client) {
+    if (client.recv_armed || client.sends_in_flight > 0) {
+        return;
+    }
+    close(client.fd);
+    clients_.erase(client.id);
+}
@@ -0,0 +1,138 @@
+#ifndef IOURING_ECHO_SERVER_H
+#define IOURING_ECHO_SERVER_H
+
+#include <linux/io_uring.h>
+#include <sys/socket.h>
+#include <netinet/in.h>
+#include <arpa/inet.h>
+#include <unistd.h>
+#include <errno.h>
+
+#include <string>
+#include <vector>
+#include <map>
+#include <memory>
+#include <atomic>
+#include <mutex>
+#include <cstring>
+
+#include "chunk_buffer.h"
+#include "logger.h"
+#include "socket_utils.h"
+#include "epoll_echo_server.h"
+
+// 基于io_uring的Echo服务器，对外接口与ReactorEchoServer/EpollEchoServer一致
+// - 监听socket使用multishot accept，一次提交持续产生新连接
+// - 接收使用multishot recv + provided buffer ring，由内核从共享缓冲区环中挑选缓冲区
+// - 回显数据按数据块提交一串IOSQE_IO_LINK链接的send，保证同一连接上的发送顺序
+// - 发送缓冲区超过高水位时取消multishot recv，发到低水位以下再重新提交，对端只发不收时不会无限缓存
+// 内核不支持(io_uring不可用或低于6.0)时自动退回到EpollEchoServer
+class IoUringEchoServer {
+public:
+    IoUringEchoServer(const std::string& host = "localhost", int port = 8888);
+    ~IoUringEchoServer();
+
+    // 阻塞运行直到stop()；启动失败时返回false
+    bool start();
+    // 可以在其他线程中调用(不能在信号处理函数中调用)，start()之前或启动期间调用也会生效
+    void stop();
+
+    bool using_fallback() {
+        std::lock_guard<std::mutex> lock(mutex_);
+        return fallback_ != nullptr;
+    }
+
+private:
+    struct ClientData {
+        int fd;
+        uint64_t id;
+        SocketAddress addr;
+        ChunkBuffer send_buffer;
+        int sends_in_flight;    // 已提交但尚未完成的send个数
+        bool recv_armed;        // multishot recv是否仍然有效
+        bool recv_paused;       // 发送缓冲区超过高水位，multishot recv已取消或正在取消
+        bool flush_queued;      // 是否已在本批次的flush_ids_中
+        bool closing;
+
+        ClientData(int socket_fd, uint64_t conn_id, const SocketAddress& client_addr, ChunkPool& pool)
+            : fd(socket_fd), id(conn_id), addr(client_addr), send_buffer(pool),
+              sends_in_flight(0), recv_armed(false), recv_paused(false), flush_queued(false), closing(false) {}
+    };
+
+    // user_data高8位表示操作类型，低56位是连接id
+    enum OpType : uint64_t {
+        OP_ACCEPT = 1,
+        OP_RECV = 2,
+        OP_SEND = 3,
+        OP_CANCEL = 4,
+    };
+
+    bool setup_ring();
+    bool setup_buffer_ring();
+    void destroy_ring();
+    io_uring_sqe* get_sqe();
+    int submit_and_wait(unsigned wait_nr);
+    void recycle_buffer(unsigned short bid);
+
+    void setup_server_socket();
+    void event_loop();
+    void cleanup();
+    void handle_completion(uint64_t user_data, int res, unsigned flags);
+    void arm_accept();
+    void arm_recv(ClientData& client);
+    void pause_recv(ClientData& client);
+    void flush_sends(ClientData& client);
+    void handle_accept(int res, unsigned flags);
+    void handle_recv(ClientData& client, int res, unsigned flags);
+    void handle_send(ClientData& client, int res);
+    void close_connection(ClientData& client);
+    void release_if_idle(ClientData& client);
+
+    std::string host_;
+    int port_;
+    int server_fd_;
+    std::atomic<bool> running_;
+
+    // io_uring提交队列/完成队列的共享内存
+    int ring_fd_;
+    void* ring_ptr_;
+    size_t ring_size_;
+    io_uring_sqe* sqes_;
+    size_t sqes_size_;
+    unsigned* sq_head_;
+    unsigned* sq_tail_;
+    unsigned sq_mask_;
+    unsigned sq_entries_;
+    unsigned sqe_tail_;
+    unsigned* cq_head_;
+    unsigned* cq_tail_;
+    unsigned cq_mask_;
+    io_uring_cqe* cqes_;
+
+    // provided buffer ring
+    io_uring_buf* buf_ring_;
+    char* buffers_;
+    unsigned short buf_tail_;
+
+    ChunkPool pool_;
+    std::map<uint64_t, std::unique_ptr<ClientData>> clients_;
+    uint64_t next_client_id_;
+    bool accept_armed_;
+    std::vector<uint64_t> flush_ids_;
+
+    // io_uring不可用时的退路；mutex_保护fallback_的创建和stop_requested_，stop()可能在其他线程中调用
+    std::mutex mutex_;
+    bool stop_requested_;
+    std::unique_ptr<EpollEchoServer> fallback_;
+
+    static const unsigned RING_ENTRIES = 256;
+    static const unsigned BUF_RING_ENTRIES = 256;
+    static const unsigned BUF_SIZE = 4096;
+    static const unsigned short BUF_GROUP = 0;
+    static const int MAX_LINKED_SENDS = 16;
+    // 与ReactorOptions的默认值相同
+    static const size_t SEND_HIGH_WATER_MARK = 1024 * 1024;
+    static const size_t SEND_LOW_WATER_MARK = 256 * 1024;
+};
+
+#endif // IOURING_ECHO_SERVER_H
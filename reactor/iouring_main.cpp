@@ -0,0 +1,93 @@
+#include "iouring_echo_server.h"
+#include <sys/signalfd.h>
+#include <sys/eventfd.h>
+#include <poll.h>
+#include <csignal>
+#include <thread>
+
+// 信号处理方式与epoll_main相同：启动任何线程之前屏蔽SIGINT/SIGTERM，主线程通过signalfd读取，
+// 在普通上下文中调用stop()。stop()在退回epoll时要加锁并访问各事件循环，不能放在信号处理函数里。
+
+int main() {
+    // 必须在第一条日志之前屏蔽：日志的后台线程在第一次写日志时创建，会继承当前的信号掩码
+    signal(SIGINT, SIG_DFL);
+    signal(SIGTERM, SIG_DFL);
+    sigset_t mask;
+    sigemptyset(&mask);
+    sigaddset(&mask, SIGINT);
+    sigaddset(&mask, SIGTERM);
+    pthread_sigmask(SIG_BLOCK, &mask, nullptr);
+
+    signal(SIGPIPE, SIG_IGN);
+
+    LOG_INFO("启动 io_uring Echo 服务器...");
+
+    int signal_fd = -1;
+    int done_fd = -1;
+    int exit_code = 0;
+    try {
+        IoUringEchoServer server("0.0.0.0", 8888);
+
+        signal_fd = signalfd(-1, &mask, SFD_CLOEXEC);
+        done_fd = eventfd(0, EFD_CLOEXEC);
+        if (signal_fd == -1 || done_fd == -1) {
+            throw std::runtime_error(std::string("signalfd/eventfd failed: ") + strerror(errno));
+        }
+
+        LOG_INFO("服务器已启动，使用 telnet localhost 8888 进行测试");
+        LOG_INFO("按 Ctrl+C 停止服务器");
+
+        // 服务器在单独的线程中运行，退出时通过done_fd通知主线程；异常不能离开线程函数
+        bool server_ok = false;
+        std::thread server_thread([&server, &server_ok, done_fd]() {
+            try {
+                server_ok = server.start();
+            } catch (const std::exception& e) {
+                LOG_ERROR("服务器异常退出: " << e.what());
+            }
+            uint64_t one = 1;
+            ssize_t n = write(done_fd, &one, sizeof(one));
+            (void)n;
+        });
+
+        while (true) {
+            pollfd pfds[2] = {{done_fd, POLLIN, 0}, {signal_fd, POLLIN, 0}};
+            if (poll(pfds, 2, -1) == -1) {
+                if (errno == EINTR) {
+                    continue;
+                }
+                LOG_ERROR("poll error: " << strerror(errno));
+                server.stop();
+                break;
+            }
+            if (pfds[0].revents & POLLIN) {
+                break;
+            }
+            if (pfds[1].revents & POLLIN) {
+                signalfd_siginfo info;
+                if (read(signal_fd, &info, sizeof(info)) == sizeof(info)) {
+                    LOG_INFO("接收到信号 " << info.ssi_signo << ", 停止服务器");
+                    server.stop();
+                }
+            }
+        }
+
+        server_thread.join();
+        if (!server_ok) {
+            exit_code = 1;
+        }
+    } catch (const std::exception& e) {
+        LOG_ERROR("错误: " << e.what());
+        exit_code = 1;
+    }
+
+    if (signal_fd != -1) {
+        close(signal_fd);
+    }
+    if (done_fd != -1) {
+        close(done_fd);
+    }
+
+    LOG_INFO("服务器已关闭");
+    return exit_code;
+}
@@ -0,0 +1,85 @@
+#include "latency_histogram.h"
+
+#include <algorithm>
+#include <cmath>
+
+LatencyHistogram::LatencyHistogram()
+    : buckets_((1 << LINEAR_BITS) + MAX_EXPONENT * (1 << SUB_BUCKET_BITS), 0),
+      count_(0), sum_(0), min_(UINT64_MAX), max_(0) {
+}
+
+size_t LatencyHistogram::bucket_index(uint64_t value) {
+    if (value < (1u << LINEAR_BITS)) {
+        return (size_t)value;
+    }
+    // 最高位决定所在的段，紧跟其后的SUB_BUCKET_BITS位决定段内的桶
+    int msb = 63 - __builtin_clzll(value);
+    int exponent = msb - SUB_BUCKET_BITS;
+    uint64_t mantissa = value >> exponent;
+    return (1u << LINEAR_BITS) + (size_t)(exponent - 1) * (1u << SUB_BUCKET_BITS)
+           + (size_t)(mantissa - (1u << SUB_BUCKET_BITS));
+}
+
+uint64_t LatencyHistogram::bucket_upper(size_t index) {
+    if (index < (1u << LINEAR_BITS)) {
+        return index;
+    }
+    size_t offset = index - (1u << LINEAR_BITS);
+    int exponent = (int)(offset >> SUB_BUCKET_BITS) + 1;
+    uint64_t mantissa = (offset & ((1u << SUB_BUCKET_BITS) - 1)) + (1u << SUB_BUCKET_BITS);
+    return ((mantissa + 1) << exponent) - 1;
+}
+
+void LatencyHistogram::record(uint64_t value) {
+    buckets_[bucket_index(value)]++;
+    count_++;
+    sum_ += value;
+    if (value < min_) {
+        min_ = value;
+    }
+    if (value > max_) {
+        max_ = value;
+    }
+}
+
+void LatencyHistogram::merge(const LatencyHistogram& other) {
+    for (size_t i = 0; i < buckets_.size(); i++) {
+        buckets_[i] += other.buckets_[i];
+    }
+    count_ += other.count_;
+    sum_ += other.sum_;
+    if (other.min_ < min_) {
+        min_ = other.min_;
+    }
+    if (other.max_ > max_) {
+        max_ = other.max_;
+    }
+}
+
+void LatencyHistogram::reset() {
+    std::fill(buckets_.begin(), buckets_.end(), 0);
+    count_ = 0;
+    sum_ = 0;
+    min_ = UINT64_MAX;
+    max_ = 0;
+}
+
+uint64_t LatencyHistogram::percentile(double p) const {
+    if (count_ == 0) {
+        return 0;
+    }
+    uint64_t target = (uint64_t)std::ceil(p / 100.0 * count_);
+    if (target == 0) {
+        target = 1;
+    }
+
+    uint64_t seen = 0;
+    for (size_t i = 0; i < buckets_.size(); i++) {
+        seen += buckets_[i];
+        if (seen >= target) {
+            uint64_t upper = bucket_upper(i);
+            return upper < max_ ? upper : max_;
+        }
+    }
+    return max_;
+}
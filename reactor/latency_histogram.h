@@ -0,0 +1,43 @@
+#ifndef LATENCY_HISTOGRAM_H
+#define LATENCY_HISTOGRAM_H
+
+#include <cstdint>
+#include <cstddef>
+#include <vector>
+
+// HDR风格的延迟直方图
+// 小于128的值每个值一个桶；更大的值按2的幂分段，每段再线性分成64个桶，
+// 相对误差不超过1/64，记录是一次位运算加一次数组自增，可以放在压测的热路径上。
+// 每个线程各用一个，结束后merge到一起再求分位数。
+class LatencyHistogram {
+public:
+    LatencyHistogram();
+
+    void record(uint64_t value);
+    void merge(const LatencyHistogram& other);
+    void reset();
+
+    // 分位数，p取值0~100，返回所在桶的上界
+    uint64_t percentile(double p) const;
+
+    uint64_t count() const { return count_; }
+    uint64_t min() const { return count_ ? min_ : 0; }
+    uint64_t max() const { return max_; }
+    double mean() const { return count_ ? (double)sum_ / count_ : 0; }
+
+private:
+    static const int LINEAR_BITS = 7;                       // 0~127逐值记录
+    static const int SUB_BUCKET_BITS = LINEAR_BITS - 1;     // 之后每段64个桶
+    static const int MAX_EXPONENT = 64 - LINEAR_BITS;
+
+    static size_t bucket_index(uint64_t value);
+    static uint64_t bucket_upper(size_t index);
+
+    std::vector<uint64_t> buckets_;
+    uint64_t count_;
+    uint64_t sum_;
+    uint64_t min_;
+    uint64_t max_;
+};
+
+#endif // LATENCY_HISTOGRAM_H
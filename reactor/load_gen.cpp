@@ -0,0 +1,591 @@
+#include "epoll_echo_server.h"
+#include "reactor_echo_server.h"
+#include "latency_histogram.h"
+
+#include <sys/epoll.h>
+#include <sys/resource.h>
+#include <sys/wait.h>
+#include <netinet/tcp.h>
+#include <arpa/inet.h>
+#include <poll.h>
+#include <csignal>
+
+#include <atomic>
+#include <chrono>
+#include <iostream>
+#include <iomanip>
+#include <thread>
+#include <vector>
+#include <cstdlib>
+
+// Echo服务器负载生成器
+// 每个客户端线程用一个epoll管理自己的一批非阻塞连接，每个连接始终保持depth条消息在途，
+// 收到一条完整回显就记录延迟并立即补发一条(闭环压测)。
+// 用法:
+//   ./load_gen [选项]
+//     --host 地址        目标地址，默认127.0.0.1；可以是IPv6地址、主机名或 unix:/路径，
+//                        与--engine同时使用时服务器监听这个地址，可以对比回环TCP和Unix域socket
+//     --port 端口        目标端口，默认8888
+//     --engine 引擎      在子进程中启动对应的服务器再压测，多个引擎用逗号分隔，依次压测并并排输出
+//                        select   Reactor<SelectBackend>，参数同ReactorEchoServer
+//                        reactor  ReactorEchoServer(单线程epoll)
+//                        epoll    EpollEchoServer
+//                        both     等同于select,epoll
+//     --conns N          并发连接数，默认1000(select引擎受FD_SETSIZE限制，活跃加空闲不要超过1000)
+//     --idle N           另外建立N个只连接不发送的空闲连接，默认0，用来观察总连接数对每次唤醒开销的影响
+//     --threads N        客户端线程数，默认CPU数
+//     --size N           每条消息的字节数(含结尾换行)，默认64
+//     --depth N          每个连接的流水线深度，默认1
+//     --duration 秒      统计时长，默认10
+//     --warmup 秒        预热时长，不计入统计，默认1
+// 服务器连接后先发一行欢迎消息时(epoll引擎)，自动识别并跳过。
+
+struct LoadConfig {
+    std::string host = "127.0.0.1";
+    int port = 8888;
+    std::string engine;
+    int conns = 1000;
+    int idle = 0;
+    int threads = 0;
+    size_t size = 64;
+    int depth = 1;
+    int duration = 10;
+    int warmup = 1;
+};
+
+struct LoadResult {
+    std::string name;
+    uint64_t messages = 0;
+    uint64_t bytes = 0;
+    uint64_t errors = 0;
+    double seconds = 0;
+    LatencyHistogram latency;   // 纳秒
+};
+
+// 压测阶段：预热期间的延迟不计入统计
+enum Phase { PHASE_WARMUP, PHASE_MEASURE, PHASE_STOP };
+
+static uint64_t now_ns() {
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(
+        std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+static int connect_to(const LoadConfig& config) {
+    SocketAddress addr = SocketAddress::resolve(config.host, config.port);
+
+    // 服务器可能还没开始监听，重试几次；Unix域socket文件还没创建时是ENOENT
+    for (int retry = 0; retry < 200; retry++) {
+        int fd = socket(addr.family(), SOCK_STREAM, 0);
+        if (fd == -1) {
+            throw std::runtime_error(std::string("socket failed: ") + strerror(errno));
+        }
+        if (connect(fd, addr.data(), addr.size()) == 0) {
+            if (!addr.is_unix()) {
+                int opt = 1;
+                setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &opt, sizeof(opt));
+            }
+            return fd;
+        }
+        int err = errno;
+        close(fd);
+        if (err != ECONNREFUSED && err != ENOENT) {
+            throw std::runtime_error(std::string("connect failed: ") + strerror(err));
+        }
+        std::this_thread::sleep_for(std::chrono::milliseconds(10));
+    }
+    throw std::runtime_error("connect failed: 服务器没有响应");
+}
+
+// 连接后短暂等待，服务器主动发来数据说明它有欢迎消息
+static bool probe_welcome(const LoadConfig& config) {
+    int fd = connect_to(config);
+    pollfd pfd = {fd, POLLIN, 0};
+    bool welcome = poll(&pfd, 1, 300) == 1;
+    close(fd);
+    return welcome;
+}
+
+class LoadWorker {
+public:
+    LoadWorker(const LoadConfig& config, int num_conns, bool skip_welcome,
+               const std::atomic<int>& phase)
+        : config_(config), num_conns_(num_conns), skip_welcome_(skip_welcome), phase_(phase),
+          epoll_fd_(-1), messages_(0), bytes_(0), errors_(0) {}
+
+    ~LoadWorker() {
+        for (Conn& conn : conns_) {
+            if (conn.fd != -1) {
+                close(conn.fd);
+            }
+        }
+        if (epoll_fd_ != -1) {
+            close(epoll_fd_);
+        }
+    }
+
+    void connect_all();
+    void run();
+
+    uint64_t messages() const { return messages_; }
+    uint64_t bytes() const { return bytes_; }
+    uint64_t errors() const { return errors_; }
+    const LatencyHistogram& latency() const { return latency_; }
+
+private:
+    struct Conn {
+        int fd;
+        bool in_welcome;        // 还在跳过欢迎消息
+        bool want_write;        // 是否已注册EPOLLOUT
+        uint64_t send_pending;  // 还没写出的字节数
+        uint64_t send_offset;   // 当前消息已写出的字节数
+        uint64_t recv_left;     // 当前消息还差多少字节
+        std::vector<uint64_t> sent_at;  // 在途消息的发出时间，按depth大小循环使用
+        size_t sent_head;
+        size_t sent_count;
+    };
+
+    void enqueue(Conn& conn, uint64_t now);
+    void flush(size_t index);
+    void on_readable(size_t index);
+    void fail(size_t index);
+
+    const LoadConfig& config_;
+    int num_conns_;
+    bool skip_welcome_;
+    const std::atomic<int>& phase_;
+
+    int epoll_fd_;
+    std::vector<Conn> conns_;
+    std::vector<char> payload_;     // 首尾相接的若干条消息，从任意偏移开始都是合法的字节流
+    std::vector<char> recv_buf_;
+
+    uint64_t messages_;
+    uint64_t bytes_;
+    uint64_t errors_;
+    LatencyHistogram latency_;
+
+    static const size_t IO_SIZE = 64 * 1024;
+};
+
+void LoadWorker::connect_all() {
+    epoll_fd_ = epoll_create1(0);
+    if (epoll_fd_ == -1) {
+        throw std::runtime_error(std::string("epoll_create1 failed: ") + strerror(errno));
+    }
+
+    // 消息内容是size-1个'x'加一个换行
+    size_t copies = IO_SIZE / config_.size + 2;
+    payload_.reserve(copies * config_.size);
+    for (size_t i = 0; i < copies; i++) {
+        payload_.insert(payload_.end(), config_.size - 1, 'x');
+        payload_.push_back('\n');
+    }
+    recv_buf_.resize(IO_SIZE);
+
+    conns_.reserve(num_conns_);
+    for (int i = 0; i < num_conns_; i++) {
+        int fd = connect_to(config_);
+        set_non_blocking(fd);
+
+        Conn conn;
+        conn.fd = fd;
+        conn.in_welcome = skip_welcome_;
+        conn.want_write = false;
+        conn.send_pending = 0;
+        conn.send_offset = 0;
+        conn.recv_left = config_.size;
+        conn.sent_at.assign(config_.depth, 0);
+        conn.sent_head = 0;
+        conn.sent_count = 0;
+        conns_.push_back(conn);
+
+        epoll_event ev;
+        ev.events = EPOLLIN;
+        ev.data.u64 = i;
+        epoll_ctl(epoll_fd_, EPOLL_CTL_ADD, fd, &ev);
+    }
+}
+
+void LoadWorker::enqueue(Conn& conn, uint64_t now) {
+    size_t tail = (conn.sent_head + conn.sent_count) % conn.sent_at.size();
+    conn.sent_at[tail] = now;
+    conn.sent_count++;
+    conn.send_pending += config_.size;
+}
+
+void LoadWorker::flush(size_t index) {
+    Conn& conn = conns_[index];
+    while (conn.send_pending > 0) {
+        size_t len = conn.send_pending < IO_SIZE ? conn.send_pending : IO_SIZE;
+        ssize_t n = send(conn.fd, payload_.data() + conn.send_offset, len, MSG_NOSIGNAL);
+        if (n < 0) {
+            if (errno == EAGAIN || errno == EWOULDBLOCK) {
+                break;
+            }
+            fail(index);
+            return;
+        }
+        conn.send_pending -= n;
+        conn.send_offset = (conn.send_offset + n) % config_.size;
+    }
+
+    // 内核发送缓冲区满时等待可写事件，写完后取消
+    bool want_write = conn.send_pending > 0;
+    if (want_write != conn.want_write) {
+        conn.want_write = want_write;
+        epoll_event ev;
+        ev.events = EPOLLIN | (want_write ? (uint32_t)EPOLLOUT : 0u);
+        ev.data.u64 = index;
+        epoll_ctl(epoll_fd_, EPOLL_CTL_MOD, conn.fd, &ev);
+    }
+}
+
+void LoadWorker::on_readable(size_t index) {
+    Conn& conn = conns_[index];
+    ssize_t n = recv(conn.fd, recv_buf_.data(), recv_buf_.size(), 0);
+    if (n <= 0) {
+        if (n < 0 && (errno == EAGAIN || errno == EWOULDBLOCK)) {
+            return;
+        }
+        fail(index);
+        return;
+    }
+
+    uint64_t now = now_ns();
+    bool measuring = phase_.load(std::memory_order_relaxed) == PHASE_MEASURE;
+    const char* data = recv_buf_.data();
+    size_t left = n;
+
+    if (conn.in_welcome) {
+        const char* end = (const char*)memchr(data, '\n', left);
+        if (end == nullptr) {
+            return;
+        }
+        conn.in_welcome = false;
+        left -= end + 1 - data;
+        data = end + 1;
+        // 欢迎消息读完才开始发送
+        for (int i = 0; i < config_.depth; i++) {
+            enqueue(conn, now);
+        }
+    }
+
+    if (measuring) {
+        bytes_ += left;
+    }
+
+    // 按消息边界切分，每凑满一条就记录延迟并补发一条
+    while (left > 0) {
+        size_t take = left < conn.recv_left ? left : conn.recv_left;
+        conn.recv_left -= take;
+        left -= take;
+        if (conn.recv_left > 0) {
+            break;
+        }
+        conn.recv_left = config_.size;
+
+        if (conn.sent_count == 0) {
+            // 收到的比发出的多，服务器的行为不是echo
+            fail(index);
+            return;
+        }
+        uint64_t sent = conn.sent_at[conn.sent_head];
+        conn.sent_head = (conn.sent_head + 1) % conn.sent_at.size();
+        conn.sent_count--;
+        if (measuring) {
+            latency_.record(now - sent);
+            messages_++;
+        }
+        enqueue(conn, now);
+    }
+
+    flush(index);
+}
+
+void LoadWorker::fail(size_t index) {
+    Conn& conn = conns_[index];
+    if (conn.fd == -1) {
+        return;
+    }
+    errors_++;
+    epoll_ctl(epoll_fd_, EPOLL_CTL_DEL, conn.fd, nullptr);
+    close(conn.fd);
+    conn.fd = -1;
+}
+
+void LoadWorker::run() {
+    // 没有欢迎消息的服务器直接开始发送
+    uint64_t now = now_ns();
+    for (size_t i = 0; i < conns_.size(); i++) {
+        if (!conns_[i].in_welcome) {
+            for (int d = 0; d < config_.depth; d++) {
+                enqueue(conns_[i], now);
+            }
+            flush(i);
+        }
+    }
+
+    std::vector<epoll_event> events(256);
+    while (phase_.load(std::memory_order_relaxed) != PHASE_STOP) {
+        int n = epoll_wait(epoll_fd_, events.data(), events.size(), 100);
+        if (n < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            throw std::runtime_error(std::string("epoll_wait failed: ") + strerror(errno));
+        }
+        for (int i = 0; i < n; i++) {
+            size_t index = events[i].data.u64;
+            if (conns_[index].fd == -1) {
+                continue;
+            }
+            if (events[i].events & (EPOLLERR | EPOLLHUP)) {
+                fail(index);
+                continue;
+            }
+            if (events[i].events & EPOLLIN) {
+                on_readable(index);
+            }
+            if ((events[i].events & EPOLLOUT) && conns_[index].fd != -1) {
+                flush(index);
+            }
+        }
+    }
+}
+
+static LoadResult run_load(const LoadConfig& config, const std::string& name) {
+    bool skip_welcome = probe_welcome(config);
+
+    // 空闲连接在压测期间一直保持打开，不收也不发
+    std::vector<int> idle_fds;
+    for (int i = 0; i < config.idle; i++) {
+        idle_fds.push_back(connect_to(config));
+    }
+
+    int num_threads = config.threads > 0 ? config.threads : (int)std::thread::hardware_concurrency();
+    num_threads = std::max(1, std::min(num_threads, config.conns));
+
+    std::atomic<int> phase{PHASE_WARMUP};
+    std::vector<std::unique_ptr<LoadWorker>> workers;
+    for (int i = 0; i < num_threads; i++) {
+        int conns = config.conns / num_threads + (i < config.conns % num_threads ? 1 : 0);
+        workers.emplace_back(new LoadWorker(config, conns, skip_welcome, phase));
+    }
+
+    // 先建立所有连接，再同时开始发送
+    for (auto& worker : workers) {
+        worker->connect_all();
+    }
+    std::vector<std::thread> threads;
+    for (auto& worker : workers) {
+        LoadWorker* w = worker.get();
+        threads.emplace_back([w]() { w->run(); });
+    }
+
+    std::this_thread::sleep_for(std::chrono::seconds(config.warmup));
+    uint64_t start = now_ns();
+    phase = PHASE_MEASURE;
+    std::this_thread::sleep_for(std::chrono::seconds(config.duration));
+    phase = PHASE_STOP;
+    uint64_t end = now_ns();
+    for (auto& t : threads) {
+        t.join();
+    }
+
+    for (int fd : idle_fds) {
+        close(fd);
+    }
+
+    LoadResult result;
+    result.name = name;
+    result.seconds = (end - start) / 1e9;
+    for (auto& worker : workers) {
+        result.messages += worker->messages();
+        result.bytes += worker->bytes();
+        result.errors += worker->errors();
+        result.latency.merge(worker->latency());
+    }
+    return result;
+}
+
+// 子进程中运行的服务器，收到SIGTERM后退出
+// SIGTERM在子进程中被屏蔽，由单独的线程用sigwait同步等待后调用stop()，
+// EpollEchoServer::stop()要加锁，不能在信号处理函数中调用
+typedef Reactor<SelectBackend, EchoHandler> SelectEchoReactor;
+static std::atomic<SelectEchoReactor*> g_select_server{nullptr};
+static std::atomic<ReactorEchoServer*> g_reactor_server{nullptr};
+static std::atomic<EpollEchoServer*> g_epoll_server{nullptr};
+
+static void wait_stop_signal(sigset_t mask) {
+    int sig;
+    sigwait(&mask, &sig);
+    if (SelectEchoReactor* server = g_select_server.load()) {
+        server->stop();
+    }
+    if (ReactorEchoServer* server = g_reactor_server.load()) {
+        server->stop();
+    }
+    if (EpollEchoServer* server = g_epoll_server.load()) {
+        server->stop();
+    }
+}
+
+static pid_t spawn_server(const std::string& engine, const std::string& host, int port) {
+    pid_t pid = fork();
+    if (pid < 0) {
+        throw std::runtime_error(std::string("fork failed: ") + strerror(errno));
+    }
+    if (pid > 0) {
+        return pid;
+    }
+
+    // 在创建任何线程之前屏蔽，服务器的线程都会继承
+    sigset_t mask;
+    sigemptyset(&mask);
+    sigaddset(&mask, SIGTERM);
+    pthread_sigmask(SIG_BLOCK, &mask, nullptr);
+    std::thread(wait_stop_signal, mask).detach();
+
+    Logger::set_level(LOG_LEVEL_WARN);
+    if (engine == "select") {
+        SelectEchoReactor server(host, port, ReactorEchoServer::default_options());
+        g_select_server = &server;
+        server.start();
+        g_select_server = nullptr;
+    } else if (engine == "reactor") {
+        ReactorEchoServer server(host, port);
+        g_reactor_server = &server;
+        server.start();
+        g_reactor_server = nullptr;
+    } else {
+        EpollEchoServer server(host, port);
+        g_epoll_server = &server;
+        server.start();
+        g_epoll_server = nullptr;
+    }
+    exit(0);
+}
+
+static void stop_server(pid_t pid) {
+    kill(pid, SIGTERM);
+    int status;
+    waitpid(pid, &status, 0);
+}
+
+static void print_result(const LoadResult& r) {
+    auto us = [](uint64_t ns) { return ns / 1000.0; };
+    std::cout << std::fixed << std::setprecision(1)
+              << std::left << std::setw(8) << r.name << std::right
+              << std::setw(12) << (uint64_t)(r.messages / r.seconds)
+              << std::setw(10) << r.bytes / r.seconds / (1024 * 1024)
+              << std::setw(10) << us(r.latency.percentile(50))
+              << std::setw(10) << us(r.latency.percentile(90))
+              << std::setw(10) << us(r.latency.percentile(99))
+              << std::setw(10) << us(r.latency.percentile(99.9))
+              << std::setw(10) << us(r.latency.max())
+              << std::setw(8) << r.errors << std::endl;
+}
+
+// 连接数较多时把打开文件数的软限制提到硬限制
+static void raise_fd_limit() {
+    rlimit limit;
+    if (getrlimit(RLIMIT_NOFILE, &limit) == 0 && limit.rlim_cur < limit.rlim_max) {
+        limit.rlim_cur = limit.rlim_max;
+        setrlimit(RLIMIT_NOFILE, &limit);
+    }
+}
+
+int main(int argc, char* argv[]) {
+    LoadConfig config;
+    for (int i = 1; i < argc; i++) {
+        std::string arg = argv[i];
+        if (i + 1 >= argc) {
+            std::cerr << "缺少参数值: " << arg << std::endl;
+            return 1;
+        }
+        const char* value = argv[++i];
+        if (arg == "--host") {
+            config.host = value;
+        } else if (arg == "--port") {
+            config.port = atoi(value);
+        } else if (arg == "--engine") {
+            config.engine = value;
+        } else if (arg == "--conns") {
+            config.conns = atoi(value);
+        } else if (arg == "--idle") {
+            config.idle = atoi(value);
+        } else if (arg == "--threads") {
+            config.threads = atoi(value);
+        } else if (arg == "--size") {
+            config.size = strtoul(value, nullptr, 10);
+        } else if (arg == "--depth") {
+            config.depth = atoi(value);
+        } else if (arg == "--duration") {
+            config.duration = atoi(value);
+        } else if (arg == "--warmup") {
+            config.warmup = atoi(value);
+        } else {
+            std::cerr << "未知参数: " << arg << std::endl;
+            return 1;
+        }
+    }
+    config.conns = std::max(1, config.conns);
+    config.idle = std::max(0, config.idle);
+    config.depth = std::max(1, config.depth);
+    config.duration = std::max(1, config.duration);
+    config.warmup = std::max(0, config.warmup);
+    if (config.size < 1) {
+        config.size = 1;
+    }
+    raise_fd_limit();
+
+    std::vector<std::string> engines;
+    size_t begin = 0;
+    while (begin < config.engine.size()) {
+        size_t end = config.engine.find(',', begin);
+        if (end == std::string::npos) {
+            end = config.engine.size();
+        }
+        std::string engine = config.engine.substr(begin, end - begin);
+        if (engine == "both") {
+            engines.push_back("select");
+            engines.push_back("epoll");
+        } else if (!engine.empty()) {
+            engines.push_back(engine);
+        }
+        begin = end + 1;
+    }
+
+    std::cout << "连接数: " << config.conns << " (另有空闲连接 " << config.idle << "), 消息: " << config.size << " 字节, 流水线深度: "
+              << config.depth << ", 预热 " << config.warmup << " 秒, 统计 " << config.duration << " 秒"
+              << std::endl;
+    std::cout << std::left << std::setw(8) << "engine" << std::right
+              << std::setw(12) << "msg/s" << std::setw(10) << "MB/s"
+              << std::setw(10) << "p50(us)" << std::setw(10) << "p90(us)" << std::setw(10) << "p99(us)"
+              << std::setw(10) << "p999(us)" << std::setw(10) << "max(us)" << std::setw(8) << "errors"
+              << std::endl;
+
+    try {
+        if (engines.empty()) {
+            print_result(run_load(config, config.host));
+        }
+        for (const std::string& engine : engines) {
+            if (engine != "select" && engine != "reactor" && engine != "epoll") {
+                std::cerr << "未知引擎: " << engine << std::endl;
+                return 1;
+            }
+            pid_t pid = spawn_server(engine, config.host, config.port);
+            try {
+                print_result(run_load(config, engine));
+            } catch (...) {
+                stop_server(pid);
+                throw;
+            }
+            stop_server(pid);
+        }
+    } catch (const std::exception& e) {
+        std::cerr << "错误: " << e.what() << std::endl;
+        return 1;
+    }
+    return 0;
+}
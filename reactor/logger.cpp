@@ -0,0 +1,263 @@
+#include "logger.h"
+
+#include <time.h>
+#include <unistd.h>
+#include <errno.h>
+
+#include <charconv>
+#include <chrono>
+#include <condition_variable>
+#include <cstdio>
+#include <cstring>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+std::atomic<int> Logger::level_(LOG_ACTIVE_LEVEL);
+
+LogRecord* LogRing::begin_write() {
+    uint32_t tail = tail_.load(std::memory_order_relaxed);
+    uint32_t head = head_.load(std::memory_order_acquire);
+    if (tail - head >= CAPACITY) {
+        dropped_.fetch_add(1, std::memory_order_relaxed);
+        return nullptr;
+    }
+    return &records_[tail & (CAPACITY - 1)];
+}
+
+void LogRing::end_write() {
+    tail_.store(tail_.load(std::memory_order_relaxed) + 1, std::memory_order_release);
+}
+
+struct Logger::Impl {
+    std::mutex mutex;
+    std::condition_variable wakeup;
+    std::condition_variable flushed;
+    std::vector<std::unique_ptr<LogRing>> rings;   // 只增不减，线程退出后留给新线程复用
+    std::thread flusher;
+    bool stopping = false;
+    uint64_t flush_requests = 0;
+    uint64_t passes = 0;
+
+    // 刷新线程独占
+    std::string out;
+    std::string err;
+    time_t cached_second = -1;
+    char cached_prefix[16];
+
+    static constexpr int FLUSH_INTERVAL_MS = 10;
+
+    void run();
+    size_t drain_all(const std::vector<LogRing*>& snapshot);
+    void format(const LogRecord& record);
+    static void write_all(int fd, std::string& data);
+};
+
+// 取出所有线程缓冲区中的日志，各自攒成一个批次后一次写出
+size_t Logger::Impl::drain_all(const std::vector<LogRing*>& snapshot) {
+    size_t count = 0;
+    for (LogRing* ring : snapshot) {
+        count += ring->drain([this](const LogRecord& record) { format(record); });
+
+        uint64_t dropped = ring->take_dropped();
+        if (dropped > 0) {
+            err += "[logger] 日志缓冲区已满，丢弃 " + std::to_string(dropped) + " 条日志\n";
+        }
+    }
+    write_all(STDOUT_FILENO, out);
+    write_all(STDERR_FILENO, err);
+    return count;
+}
+
+void Logger::Impl::format(const LogRecord& record) {
+    static const char* const LEVEL_NAMES[] = {"TRACE", "DEBUG", "INFO ", "WARN ", "ERROR"};
+
+    // 同一秒内的日志复用格式化好的时分秒
+    time_t second = (time_t)(record.time_us / 1000000);
+    if (second != cached_second) {
+        struct tm tm;
+        localtime_r(&second, &tm);
+        strftime(cached_prefix, sizeof(cached_prefix), "%H:%M:%S", &tm);
+        cached_second = second;
+    }
+
+    char head[48];
+    int n = snprintf(head, sizeof(head), "[%s.%06u] [%s] ", cached_prefix,
+                     (unsigned)(record.time_us % 1000000), LEVEL_NAMES[record.level]);
+
+    std::string& target = record.level >= LOG_LEVEL_WARN ? err : out;
+    target.append(head, n);
+    size_t len = record.len;
+    while (len > 0 && record.text[len - 1] == '\n') {
+        len--;
+    }
+    target.append(record.text, len);
+    target += '\n';
+}
+
+void Logger::Impl::write_all(int fd, std::string& data) {
+    size_t offset = 0;
+    while (offset < data.size()) {
+        ssize_t n = ::write(fd, data.data() + offset, data.size() - offset);
+        if (n < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            break;  // 输出不可写时丢弃，日志不能影响服务
+        }
+        offset += n;
+    }
+    data.clear();
+}
+
+void Logger::Impl::run() {
+    std::vector<LogRing*> snapshot;
+    std::unique_lock<std::mutex> lock(mutex);
+
+    while (true) {
+        if (!stopping && flush_requests == passes) {
+            wakeup.wait_for(lock, std::chrono::milliseconds(FLUSH_INTERVAL_MS));
+        }
+        bool stop = stopping;
+        uint64_t requested = flush_requests;
+        snapshot.clear();
+        for (auto& ring : rings) {
+            snapshot.push_back(ring.get());
+        }
+
+        // 格式化和write不持锁，登记新线程不受影响
+        lock.unlock();
+        drain_all(snapshot);
+        lock.lock();
+
+        if (requested > passes) {
+            passes = requested;
+            flushed.notify_all();
+        }
+        if (stop) {
+            break;
+        }
+    }
+}
+
+Logger& Logger::instance() {
+    static Logger logger;
+    return logger;
+}
+
+Logger::Logger() : impl_(new Impl) {
+    impl_->flusher = std::thread([this]() { impl_->run(); });
+}
+
+Logger::~Logger() {
+    {
+        std::lock_guard<std::mutex> lock(impl_->mutex);
+        impl_->stopping = true;
+    }
+    impl_->wakeup.notify_one();
+    impl_->flusher.join();
+    delete impl_;
+}
+
+void Logger::flush() {
+    std::unique_lock<std::mutex> lock(impl_->mutex);
+    uint64_t target = ++impl_->flush_requests;
+    impl_->wakeup.notify_one();
+    impl_->flushed.wait(lock, [this, target]() { return impl_->passes >= target || impl_->stopping; });
+}
+
+namespace {
+
+// 线程退出时把环形缓冲区还回去，剩余的日志仍由刷新线程输出
+struct ThreadRingHolder {
+    LogRing* ring = nullptr;
+    ~ThreadRingHolder() {
+        if (ring) {
+            ring->in_use().store(false, std::memory_order_release);
+        }
+    }
+};
+
+thread_local ThreadRingHolder t_ring;
+
+}  // namespace
+
+LogRing& Logger::thread_ring() {
+    if (t_ring.ring) {
+        return *t_ring.ring;
+    }
+
+    std::lock_guard<std::mutex> lock(impl_->mutex);
+    for (auto& ring : impl_->rings) {
+        bool expected = false;
+        if (ring->in_use().compare_exchange_strong(expected, true)) {
+            t_ring.ring = ring.get();
+            return *t_ring.ring;
+        }
+    }
+    impl_->rings.emplace_back(new LogRing);
+    t_ring.ring = impl_->rings.back().get();
+    t_ring.ring->in_use().store(true, std::memory_order_relaxed);
+    return *t_ring.ring;
+}
+
+LogLine::LogLine(int level) : ring_(Logger::instance().thread_ring()), record_(ring_.begin_write()) {
+    if (record_) {
+        struct timespec ts;
+        clock_gettime(CLOCK_REALTIME, &ts);
+        record_->time_us = (uint64_t)ts.tv_sec * 1000000 + ts.tv_nsec / 1000;
+        record_->level = (uint8_t)level;
+        record_->len = 0;
+    }
+}
+
+LogLine::~LogLine() {
+    if (record_) {
+        ring_.end_write();
+    }
+}
+
+void LogLine::append(const char* data, size_t len) {
+    if (record_ == nullptr) {
+        return;
+    }
+    // 超长的部分截断
+    size_t room = LogRecord::TEXT_SIZE - record_->len;
+    if (len > room) {
+        len = room;
+    }
+    memcpy(record_->text + record_->len, data, len);
+    record_->len += len;
+}
+
+LogLine& LogLine::operator<<(const char* str) {
+    append(str, strlen(str));
+    return *this;
+}
+
+LogLine& LogLine::operator<<(double value) {
+    char buf[32];
+    int n = snprintf(buf, sizeof(buf), "%g", value);
+    append(buf, n);
+    return *this;
+}
+
+LogLine& LogLine::operator<<(const void* ptr) {
+    char buf[32];
+    int n = snprintf(buf, sizeof(buf), "%p", ptr);
+    append(buf, n);
+    return *this;
+}
+
+void LogLine::append_integer(long long value) {
+    char buf[24];
+    auto result = std::to_chars(buf, buf + sizeof(buf), value);
+    append(buf, result.ptr - buf);
+}
+
+void LogLine::append_integer(unsigned long long value) {
+    char buf[24];
+    auto result = std::to_chars(buf, buf + sizeof(buf), value);
+    append(buf, result.ptr - buf);
+}
@@ -0,0 +1,158 @@
+#ifndef LOGGER_H
+#define LOGGER_H
+
+#include <atomic>
+#include <cstdint>
+#include <cstddef>
+#include <string>
+#include <type_traits>
+
+// 日志级别
+#define LOG_LEVEL_TRACE 0
+#define LOG_LEVEL_DEBUG 1
+#define LOG_LEVEL_INFO  2
+#define LOG_LEVEL_WARN  3
+#define LOG_LEVEL_ERROR 4
+#define LOG_LEVEL_OFF   5
+
+// 编译期日志级别，低于它的日志语句连同参数求值一起被编译器删除
+// 例如 -DLOG_ACTIVE_LEVEL=LOG_LEVEL_TRACE 打开每次收发和select调用的日志
+#ifndef LOG_ACTIVE_LEVEL
+#define LOG_ACTIVE_LEVEL LOG_LEVEL_INFO
+#endif
+
+// 用法和std::cout相同，不需要换行: LOG_INFO("接受连接 (fd: " << fd << ")");
+// 运行期级别检查只是一次relaxed原子读，未启用时不做任何格式化
+#define LOG_AT(level, expr) \
+    do { \
+        if ((level) >= LOG_ACTIVE_LEVEL && Logger::enabled(level)) { \
+            LogLine(level) << expr; \
+        } \
+    } while (0)
+
+#define LOG_TRACE(expr) LOG_AT(LOG_LEVEL_TRACE, expr)
+#define LOG_DEBUG(expr) LOG_AT(LOG_LEVEL_DEBUG, expr)
+#define LOG_INFO(expr)  LOG_AT(LOG_LEVEL_INFO, expr)
+#define LOG_WARN(expr)  LOG_AT(LOG_LEVEL_WARN, expr)
+#define LOG_ERROR(expr) LOG_AT(LOG_LEVEL_ERROR, expr)
+
+// 一条日志记录，定长，直接在环形缓冲区的槽位里格式化
+struct LogRecord {
+    static const size_t TEXT_SIZE = 240;
+
+    uint64_t time_us;   // CLOCK_REALTIME微秒
+    uint8_t level;
+    uint16_t len;
+    char text[TEXT_SIZE];
+};
+
+// 每个线程一个单生产者单消费者环形缓冲区
+// 生产者是写日志的线程，消费者是后台刷新线程，两端只通过head_/tail_同步，没有锁。
+// 写满时丢弃新日志并计数，不阻塞I/O线程。
+class LogRing {
+public:
+    static const uint32_t CAPACITY = 1024;     // 必须是2的幂
+
+    LogRing() : head_(0), tail_(0), dropped_(0), in_use_(false) {}
+
+    // 生产者：取得下一个可写槽位，满时返回nullptr
+    LogRecord* begin_write();
+    void end_write();
+
+    // 消费者：把所有已提交的记录交给f，返回处理的条数
+    template <typename F>
+    size_t drain(F f) {
+        uint32_t head = head_.load(std::memory_order_relaxed);
+        uint32_t tail = tail_.load(std::memory_order_acquire);
+        size_t count = tail - head;
+        for (; head != tail; head++) {
+            f(records_[head & (CAPACITY - 1)]);
+        }
+        head_.store(head, std::memory_order_release);
+        return count;
+    }
+
+    uint64_t take_dropped() { return dropped_.exchange(0, std::memory_order_relaxed); }
+
+    std::atomic<bool>& in_use() { return in_use_; }
+
+private:
+    alignas(64) std::atomic<uint32_t> head_;   // 消费者读到的位置
+    alignas(64) std::atomic<uint32_t> tail_;   // 生产者写到的位置
+    std::atomic<uint64_t> dropped_;
+    std::atomic<bool> in_use_;                 // 是否有线程持有，线程退出后可被新线程复用
+    LogRecord records_[CAPACITY];
+};
+
+// 异步日志器：各线程写入自己的LogRing，后台线程定期批量取出，
+// 格式化时间和级别后用一次write写到标准输出(WARN及以上写到标准错误)
+class Logger {
+public:
+    static Logger& instance();
+
+    static bool enabled(int level) {
+        return level >= level_.load(std::memory_order_relaxed);
+    }
+    // 运行期级别，只能比编译期级别更严格
+    static void set_level(int level) { level_.store(level, std::memory_order_relaxed); }
+    static int level() { return level_.load(std::memory_order_relaxed); }
+
+    // 阻塞到调用前写入的日志都已输出
+    void flush();
+
+    // 当前线程的环形缓冲区，首次调用时登记
+    LogRing& thread_ring();
+
+    ~Logger();
+
+private:
+    Logger();
+    Logger(const Logger&) = delete;
+    Logger& operator=(const Logger&) = delete;
+
+    struct Impl;
+    Impl* impl_;
+
+    static std::atomic<int> level_;
+};
+
+// 一条日志语句的格式化器，析构时提交
+class LogLine {
+public:
+    explicit LogLine(int level);
+    ~LogLine();
+
+    LogLine(const LogLine&) = delete;
+    LogLine& operator=(const LogLine&) = delete;
+
+    LogLine& operator<<(const char* str);
+    LogLine& operator<<(const std::string& str) { append(str.data(), str.size()); return *this; }
+    LogLine& operator<<(char c) { append(&c, 1); return *this; }
+    LogLine& operator<<(bool value) { return *this << (value ? "true" : "false"); }
+    LogLine& operator<<(double value);
+    LogLine& operator<<(const void* ptr);
+
+    template <typename T>
+    typename std::enable_if<std::is_integral<T>::value, LogLine&>::type operator<<(T value) {
+        append_integer(value);
+        return *this;
+    }
+
+private:
+    void append(const char* data, size_t len);
+    void append_integer(long long value);
+    void append_integer(unsigned long long value);
+    template <typename T>
+    void append_integer(T value) {
+        if (std::is_signed<T>::value) {
+            append_integer((long long)value);
+        } else {
+            append_integer((unsigned long long)value);
+        }
+    }
+
+    LogRing& ring_;
+    LogRecord* record_;     // 环形缓冲区满时为nullptr，本条日志丢弃
+};
+
+#endif // LOGGER_H
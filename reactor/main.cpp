@@ -4,19 +4,48 @@
 #include <thread>
 
 std::atomic<bool> g_running{true};
+ReactorEchoServer* g_server = nullptr;
+
+// Reactor::shutdown只做原子操作和eventfd写入，可以直接在信号处理函数中调用
+void signal_handler(int signal) {
+    (void)signal;
+    if (g_server) {
+        g_server->shutdown(5000);
+    }
+}
+
+// 用法: ./echo [--metrics 端口|unix:路径] [--host 地址] [--port 端口]
+// --host 可以是IPv4/IPv6地址、主机名或 unix:/路径，默认0.0.0.0
+int main(int argc, char* argv[]) {
+    std::string metrics_endpoint;
+    std::string host = "0.0.0.0";
+    int port = 8888;
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "--metrics") == 0 && i + 1 < argc) {
+            metrics_endpoint = argv[++i];
+        } else if (strcmp(argv[i], "--host") == 0 && i + 1 < argc) {
+            host = argv[++i];
+        } else if (strcmp(argv[i], "--port") == 0 && i + 1 < argc) {
+            port = atoi(argv[++i]);
+        }
+    }
 
-int main() {
     try {
-        ReactorEchoServer server("0.0.0.0", 8888);
+        ReactorEchoServer server(host, port, metrics_endpoint);
+        g_server = &server;
+        signal(SIGINT, signal_handler);
+        signal(SIGTERM, signal_handler);
+        signal(SIGPIPE, SIG_IGN);
         
-        std::cout << "服务器启动中... 按 Ctrl+C 停止服务器" << std::endl;
+        LOG_INFO("服务器启动中... 按 Ctrl+C 停止服务器");
         server.start();
+        g_server = nullptr;
         
     } catch (const std::exception& e) {
-        std::cerr << "程序异常: " << e.what() << std::endl;
+        LOG_ERROR("程序异常: " << e.what());
         return 1;
     }
     
-    std::cout << "程序正常退出" << std::endl;
+    LOG_INFO("程序正常退出");
     return 0;
 }
@@ -0,0 +1,175 @@
+#include "metrics.h"
+#include "logger.h"
+#include "socket_utils.h"
+
+#include <sys/eventfd.h>
+#include <sys/time.h>
+#include <poll.h>
+#include <time.h>
+
+#include <cstdlib>
+#include <cstring>
+
+uint64_t monotonic_us() {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000 + ts.tv_nsec / 1000;
+}
+
+void MetricsWriter::family(const char* name, const char* type, const char* help) {
+    text_ += "# HELP ";
+    text_ += name;
+    text_ += ' ';
+    text_ += help;
+    text_ += "\n# TYPE ";
+    text_ += name;
+    text_ += ' ';
+    text_ += type;
+    text_ += '\n';
+}
+
+void MetricsWriter::sample(const char* name, const std::string& labels, uint64_t value) {
+    text_ += name;
+    if (!labels.empty()) {
+        text_ += '{';
+        text_ += labels;
+        text_ += '}';
+    }
+    text_ += ' ';
+    text_ += std::to_string(value);
+    text_ += '\n';
+}
+
+void MetricsWriter::histogram(const char* name, const std::string& labels, const Histogram& hist) {
+    std::string bucket_name = std::string(name) + "_bucket";
+    std::string prefix = labels.empty() ? std::string() : labels + ",";
+    uint64_t cumulative = 0;
+    for (int i = 0; i < Histogram::BUCKETS - 1; i++) {
+        cumulative += hist.bucket(i);
+        sample(bucket_name.c_str(), prefix + "le=\"" + std::to_string(Histogram::upper_bound(i)) + "\"",
+               cumulative);
+    }
+    cumulative += hist.bucket(Histogram::BUCKETS - 1);
+    sample(bucket_name.c_str(), prefix + "le=\"+Inf\"", cumulative);
+    sample((std::string(name) + "_sum").c_str(), labels, hist.sum());
+    sample((std::string(name) + "_count").c_str(), labels, cumulative);
+}
+
+MetricsServer::MetricsServer(const std::string& endpoint, Render render)
+    : endpoint_(endpoint), port_(0), render_(std::move(render)), listen_fd_(-1), wake_fd_(-1) {
+}
+
+MetricsServer::~MetricsServer() {
+    stop();
+}
+
+void MetricsServer::parse_endpoint() {
+    unix_path_.clear();
+    if (endpoint_.compare(0, 5, "unix:") == 0) {
+        unix_path_ = endpoint_.substr(5);
+    } else if (!endpoint_.empty() && endpoint_[0] == '/') {
+        unix_path_ = endpoint_;
+    } else if (!endpoint_.empty() && endpoint_.size() <= 5
+               && endpoint_.find_first_not_of("0123456789") == std::string::npos) {
+        port_ = atoi(endpoint_.c_str());
+    }
+    if (unix_path_.empty() && (port_ <= 0 || port_ > 65535)) {
+        throw std::runtime_error("Invalid metrics endpoint \"" + endpoint_
+                                 + "\": expected a port number, unix:<path> or an absolute path");
+    }
+}
+
+void MetricsServer::start() {
+    parse_endpoint();
+    wake_fd_ = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+    if (wake_fd_ == -1) {
+        throw std::runtime_error(std::string("eventfd failed: ") + strerror(errno));
+    }
+    try {
+        if (!unix_path_.empty()) {
+            listen_fd_ = create_unix_listen_socket(unix_path_);
+        } else {
+            listen_fd_ = create_listen_socket("127.0.0.1", port_);
+        }
+    } catch (...) {
+        close(wake_fd_);
+        wake_fd_ = -1;
+        throw;
+    }
+    LOG_INFO("指标导出在 " << (!unix_path_.empty() ? "unix:" + unix_path_ : "127.0.0.1:" + std::to_string(port_)));
+    thread_ = std::thread(&MetricsServer::run, this);
+}
+
+void MetricsServer::stop() {
+    if (thread_.joinable()) {
+        uint64_t one = 1;
+        ssize_t n = write(wake_fd_, &one, sizeof(one));
+        (void)n;
+        thread_.join();
+    }
+    if (listen_fd_ != -1) {
+        close(listen_fd_);
+        listen_fd_ = -1;
+        if (!unix_path_.empty()) {
+            unlink(unix_path_.c_str());
+        }
+    }
+    if (wake_fd_ != -1) {
+        close(wake_fd_);
+        wake_fd_ = -1;
+    }
+}
+
+void MetricsServer::run() {
+    while (true) {
+        pollfd pfds[2] = {{wake_fd_, POLLIN, 0}, {listen_fd_, POLLIN, 0}};
+        if (poll(pfds, 2, -1) == -1) {
+            if (errno == EINTR) {
+                continue;
+            }
+            LOG_ERROR("指标导出poll错误: " << strerror(errno));
+            return;
+        }
+        if (pfds[0].revents & POLLIN) {
+            return;
+        }
+        if (pfds[1].revents & POLLIN) {
+            // 抓取是低频的，每个连接同步处理完再接受下一个
+            int client_fd = accept4(listen_fd_, nullptr, nullptr, SOCK_CLOEXEC);
+            if (client_fd != -1) {
+                serve(client_fd);
+                close(client_fd);
+            }
+        }
+    }
+}
+
+void MetricsServer::serve(int client_fd) {
+    // 客户端迟迟不发请求或不读响应时不能卡住导出线程
+    timeval timeout = {1, 0};
+    setsockopt(client_fd, SOL_SOCKET, SO_RCVTIMEO, &timeout, sizeof(timeout));
+    setsockopt(client_fd, SOL_SOCKET, SO_SNDTIMEO, &timeout, sizeof(timeout));
+
+    // 不解析请求，读到请求头结束(或超时)后总是返回全部指标
+    std::string request;
+    char buffer[1024];
+    while (request.size() < 8192 && request.find("\r\n\r\n") == std::string::npos) {
+        ssize_t n = recv(client_fd, buffer, sizeof(buffer), 0);
+        if (n <= 0) {
+            break;
+        }
+        request.append(buffer, n);
+    }
+
+    std::string body = render_();
+    std::string response = "HTTP/1.0 200 OK\r\nContent-Type: text/plain; version=0.0.4\r\nContent-Length: "
+                           + std::to_string(body.size()) + "\r\nConnection: close\r\n\r\n" + body;
+    size_t sent = 0;
+    while (sent < response.size()) {
+        ssize_t n = send(client_fd, response.data() + sent, response.size() - sent, MSG_NOSIGNAL);
+        if (n <= 0) {
+            break;
+        }
+        sent += n;
+    }
+}
@@ -0,0 +1,126 @@
+#ifndef METRICS_H
+#define METRICS_H
+
+#include <atomic>
+#include <cstdint>
+#include <functional>
+#include <string>
+#include <thread>
+
+// 单写者计数器
+// 只由所属的事件循环线程修改，修改是relaxed的读+写，不是带lock前缀的原子加，热路径上和普通变量一样便宜；
+// 其他线程(例如指标导出线程)随时可以读取，读到的是某个时刻的完整值。
+// 也用作仪表(gauge)：由写者set()当前值。
+class Counter {
+public:
+    Counter(uint64_t value = 0) : value_(value) {}
+    Counter(const Counter& other) : value_(other.value()) {}
+    Counter& operator=(const Counter& other) { set(other.value()); return *this; }
+
+    uint64_t value() const { return value_.load(std::memory_order_relaxed); }
+    operator uint64_t() const { return value(); }
+
+    void set(uint64_t value) { value_.store(value, std::memory_order_relaxed); }
+    Counter& operator+=(uint64_t n) { set(value() + n); return *this; }
+    Counter& operator++() { return *this += 1; }
+    void operator++(int) { *this += 1; }
+
+private:
+    std::atomic<uint64_t> value_;
+};
+
+// 按2的幂分桶的直方图，同样是单写者
+// 第i个桶统计(2^(i-1), 2^i]内的值(第0个桶是0和1)，最后一个桶收下所有更大的值；
+// 记录一次是一次clz加一次计数器自增。导出时转换成Prometheus要求的累计桶。
+class Histogram {
+public:
+    static const int BUCKETS = 24;
+
+    void observe(uint64_t value) {
+        int index = value <= 1 ? 0 : 64 - __builtin_clzll(value - 1);
+        if (index >= BUCKETS) {
+            index = BUCKETS - 1;
+        }
+        buckets_[index]++;
+        sum_ += value;
+    }
+
+    // 第i个桶的上界，最后一个桶没有上界(+Inf)
+    static uint64_t upper_bound(int index) { return (uint64_t)1 << index; }
+    uint64_t bucket(int index) const { return buckets_[index]; }
+    uint64_t sum() const { return sum_; }
+    uint64_t count() const {
+        uint64_t total = 0;
+        for (int i = 0; i < BUCKETS; i++) {
+            total += buckets_[i];
+        }
+        return total;
+    }
+
+    Histogram& operator+=(const Histogram& other) {
+        for (int i = 0; i < BUCKETS; i++) {
+            buckets_[i] += other.buckets_[i];
+        }
+        sum_ += other.sum_;
+        return *this;
+    }
+
+private:
+    Counter buckets_[BUCKETS];
+    Counter sum_;
+};
+
+// 单调时钟微秒数，用于统计耗时
+uint64_t monotonic_us();
+
+// Prometheus文本格式(0.0.4)的输出
+// 同一指标的所有样本必须连续输出，先用family()写一次HELP/TYPE，再逐个写样本。
+// labels是不带花括号的标签串，例如 loop="0"，可以为空。
+class MetricsWriter {
+public:
+    void family(const char* name, const char* type, const char* help);
+    void sample(const char* name, const std::string& labels, uint64_t value);
+    // 输出name_bucket{le=...}累计桶、name_sum和name_count
+    void histogram(const char* name, const std::string& labels, const Histogram& hist);
+
+    const std::string& text() const { return text_; }
+
+private:
+    std::string text_;
+};
+
+// 指标导出服务
+// 在独立线程中监听一个本地端点，每个连接返回一次render()的结果(HTTP/1.0响应)后关闭，
+// 可以直接被Prometheus抓取，也可以用curl查看。事件循环线程不参与，抓取不会打扰I/O路径。
+// 端点是纯数字时监听127.0.0.1上的该TCP端口；"unix:路径"或以/开头的绝对路径是Unix域socket，
+// 与--host unix:/路径的写法一致；其他格式(例如127.0.0.1:9100)在start()中报错，不会被当成文件名。
+class MetricsServer {
+public:
+    typedef std::function<std::string()> Render;
+
+    MetricsServer(const std::string& endpoint, Render render);
+    ~MetricsServer();
+
+    MetricsServer(const MetricsServer&) = delete;
+    MetricsServer& operator=(const MetricsServer&) = delete;
+
+    // 创建监听socket并启动导出线程，失败时抛出异常
+    void start();
+    void stop();
+
+private:
+    void run();
+    void serve(int client_fd);
+    // 解析endpoint_，得到unix_path_或port_，格式不对时抛出异常
+    void parse_endpoint();
+
+    std::string endpoint_;
+    std::string unix_path_;     // 为空时监听TCP端口port_
+    int port_;
+    Render render_;
+    int listen_fd_;
+    int wake_fd_;
+    std::thread thread_;
+};
+
+#endif // METRICS_H
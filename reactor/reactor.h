@@ -0,0 +1,1621 @@
+#ifndef REACTOR_H
+#define REACTOR_H
+
+#include <sys/socket.h>
+#include <sys/uio.h>
+#include <sys/ioctl.h>
+#include <sys/eventfd.h>
+#include <fcntl.h>
+#include <sched.h>
+#include <netinet/in.h>
+#include <unistd.h>
+#include <errno.h>
+
+#include <string>
+#include <string_view>
+#include <vector>
+#include <memory>
+#include <atomic>
+#include <cstring>
+#include <stdexcept>
+#include <type_traits>
+#include <utility>
+
+#include "chunk_buffer.h"
+#include "completion_queue.h"
+#include "connection_table.h"
+#include "event_backend.h"
+#include "logger.h"
+#include "metrics.h"
+#include "socket_utils.h"
+#include "timer_wheel.h"
+#include "cpu_affinity.h"
+#include "../threads_pool/tpool.h"
+
+// 事件循环运行参数
+struct ReactorOptions {
+    bool reuse_port = false;    // 监听socket是否开启SO_REUSEPORT
+    int poll_timeout_ms = 1000; // 等待事件的超时时间
+
+    // 边沿触发模式(仅epoll后端支持)：accept/recv/send循环直到EAGAIN
+    bool edge_triggered = false;
+    // 水平触发模式下每次唤醒也循环accept/recv直到EAGAIN或达到上限
+    bool drain_on_wakeup = false;
+    int max_accepts_per_wakeup = 64;                // 每次唤醒最多accept的连接数
+    int listen_backlog = SOMAXCONN;                 // 监听队列长度，连接风暴时队列满了新的SYN会被丢弃
+    size_t max_io_bytes_per_wakeup = 64 * 1024;     // 每个连接每次唤醒最多读/写的字节数
+
+    // 流控：发送缓冲区超过高水位时停止监听该连接的读事件，降到低水位以下再恢复，0表示不限制
+    size_t send_high_water_mark = 1024 * 1024;      // 每个连接发送缓冲区的高水位线
+    size_t send_low_water_mark = 256 * 1024;
+    // 本事件循环所有连接发送缓冲区之和的水位线，超过后所有连接读到数据时都暂停读取
+    size_t global_high_water_mark = 64 * 1024 * 1024;
+    size_t global_low_water_mark = 32 * 1024 * 1024;
+
+    // 向量化I/O：readv直接读进缓冲区数据块，每轮循环结束时每个连接只用一次writev发出所有回复；
+    // 关闭时逐块send。两种方式都先直接发送，只有内核发送缓冲区满了才注册写事件
+    bool vectored_io = false;
+
+    // splice直通：socket中待读数据不少于这么多字节时，经每个连接的管道在内核中直接回写，不经过用户态缓冲区；
+    // 只对Handler::passthrough为true且不分帧(RAW)的连接生效，0表示不启用
+    size_t splice_threshold = 0;
+
+    // 定时器，超时设为0表示不启用
+    uint64_t timer_tick_ms = 10;                    // 时间轮精度
+    uint64_t idle_timeout_ms = 5 * 60 * 1000;       // 连接在这段时间内没有收发任何数据则关闭
+    uint64_t write_stall_timeout_ms = 60 * 1000;    // 有数据待发送但这段时间内一个字节也发不出去则关闭
+
+    // 消息分帧，默认的on_message/next_frame按此把接收缓冲区切成消息；超过max_frame_size的消息会导致连接关闭
+    FrameMode frame_mode = FrameMode::RAW;
+    size_t max_frame_size = 1024 * 1024;
+
+    // 工作线程池，非空时把请求交给线程池处理(Handler的next_frame/process)，事件循环只做I/O；
+    // 线程池由调用者创建和销毁，可以被多个事件循环共享，生命周期要长于事件循环
+    tpool_t* worker_pool = nullptr;
+
+    // 监听socket和accept得到的连接上设置的socket参数，默认全部保持内核默认值
+    TcpProfile tcp;
+
+    // 低延迟部署：事件循环线程独占CPU时减少调度迁移和睡眠/唤醒带来的尾延迟
+    // 非空时start()先把调用线程绑定到这些CPU上
+    std::vector<int> cpu_affinity;
+    // 连接表、缓冲区等由事件循环线程分配的内存放在所绑CPU的NUMA节点上(MPOL_LOCAL)
+    bool numa_local = false;
+    // 忙轮询：有事件之后以0超时反复等待，线程不睡眠；连续这么多微秒没有任何事件则退回阻塞等待，
+    // 0表示不启用。TCP连接同时设置同样的SO_BUSY_POLL，网卡驱动支持时recv也先轮询设备队列
+    uint32_t busy_poll_us = 0;
+};
+
+// 事件循环的统计，只在循环线程中更新；字段都是单写者计数器，运行中其他线程也可以随时读取
+struct ReactorStats {
+    uint64_t syscalls() const {
+        return accept_calls + read_calls + write_calls + wait_calls + ctl_calls + sockopt_calls;
+    }
+    uint64_t open_connections() const { return accepted_connections - closed_connections; }
+
+    // 系统调用
+    Counter accept_calls;
+    Counter read_calls;         // recv/readv/splice
+    Counter write_calls;        // send/writev/splice
+    Counter wait_calls;         // select/epoll_wait
+    Counter ctl_calls;          // epoll_ctl
+    Counter sockopt_calls;      // setsockopt(连接参数、TCP_CORK)
+
+    // 连接和流量
+    Counter accepted_connections;
+    Counter closed_connections;
+    Counter accept_rejects;     // fd耗尽或无法加入事件后端时接受后立即关闭的连接
+    Counter bytes_read;
+    Counter bytes_written;
+    Counter spliced_bytes;      // 经splice直通回写的字节数
+    Counter idle_closes;        // 因空闲超时关闭的连接
+    Counter stall_closes;       // 因发送停滞超时关闭的连接
+
+    // 流控和工作线程池
+    Counter read_pauses;        // 因发送缓冲区积压暂停读取的次数
+    Counter global_throttles;   // 总积压超过全局高水位的次数
+    Counter offloaded_tasks;    // 交给工作线程池的任务数
+
+    // 事件循环，仪表在每轮循环结束时更新
+    Counter loop_iterations;
+    Counter empty_polls;        // 忙轮询中没有等到任何事件的等待次数
+    Counter queued_bytes;       // 仪表：所有连接发送缓冲区中排队的字节数
+    Counter tasks_in_flight;    // 仪表：已交给工作线程池、尚未取回的任务数
+    Histogram ready_events;     // 每次唤醒的就绪事件数
+    Histogram loop_busy_us;     // 每轮从唤醒到再次等待之间处理事件花费的微秒数
+
+    ReactorStats& operator+=(const ReactorStats& other) {
+        accept_calls += other.accept_calls;
+        read_calls += other.read_calls;
+        write_calls += other.write_calls;
+        wait_calls += other.wait_calls;
+        ctl_calls += other.ctl_calls;
+        sockopt_calls += other.sockopt_calls;
+        accepted_connections += other.accepted_connections;
+        closed_connections += other.closed_connections;
+        accept_rejects += other.accept_rejects;
+        bytes_read += other.bytes_read;
+        bytes_written += other.bytes_written;
+        spliced_bytes += other.spliced_bytes;
+        idle_closes += other.idle_closes;
+        stall_closes += other.stall_closes;
+        read_pauses += other.read_pauses;
+        global_throttles += other.global_throttles;
+        offloaded_tasks += other.offloaded_tasks;
+        loop_iterations += other.loop_iterations;
+        empty_polls += other.empty_polls;
+        queued_bytes += other.queued_bytes;
+        tasks_in_flight += other.tasks_in_flight;
+        ready_events += other.ready_events;
+        loop_busy_us += other.loop_busy_us;
+        return *this;
+    }
+};
+
+// 按Prometheus文本格式输出各事件循环的统计，每个样本带loop="序号"标签
+inline void write_reactor_metrics(MetricsWriter& out, const std::vector<ReactorStats>& loops) {
+    struct Field {
+        const char* name;
+        const char* type;
+        const char* help;
+        Counter ReactorStats::*value;
+    };
+    static const Field fields[] = {
+        {"reactor_accept_calls_total", "counter", "accept4调用次数", &ReactorStats::accept_calls},
+        {"reactor_read_calls_total", "counter", "recv/readv/splice调用次数", &ReactorStats::read_calls},
+        {"reactor_write_calls_total", "counter", "send/writev/splice调用次数", &ReactorStats::write_calls},
+        {"reactor_wait_calls_total", "counter", "select/epoll_wait调用次数", &ReactorStats::wait_calls},
+        {"reactor_ctl_calls_total", "counter", "epoll_ctl调用次数", &ReactorStats::ctl_calls},
+        {"reactor_sockopt_calls_total", "counter", "setsockopt调用次数", &ReactorStats::sockopt_calls},
+        {"reactor_connections_accepted_total", "counter", "接受的连接数",
+         &ReactorStats::accepted_connections},
+        {"reactor_connections_closed_total", "counter", "关闭的连接数", &ReactorStats::closed_connections},
+        {"reactor_accept_rejects_total", "counter", "fd耗尽或无法加入事件后端时接受后立即关闭的连接数",
+         &ReactorStats::accept_rejects},
+        {"reactor_read_bytes_total", "counter", "收到的字节数", &ReactorStats::bytes_read},
+        {"reactor_written_bytes_total", "counter", "发出的字节数", &ReactorStats::bytes_written},
+        {"reactor_spliced_bytes_total", "counter", "经splice直通回写的字节数", &ReactorStats::spliced_bytes},
+        {"reactor_idle_closes_total", "counter", "因空闲超时关闭的连接数", &ReactorStats::idle_closes},
+        {"reactor_stall_closes_total", "counter", "因发送停滞超时关闭的连接数",
+         &ReactorStats::stall_closes},
+        {"reactor_read_pauses_total", "counter", "因发送缓冲区积压暂停读取的次数", &ReactorStats::read_pauses},
+        {"reactor_global_throttles_total", "counter", "总积压超过全局高水位的次数",
+         &ReactorStats::global_throttles},
+        {"reactor_offloaded_tasks_total", "counter", "交给工作线程池的任务数",
+         &ReactorStats::offloaded_tasks},
+        {"reactor_loop_iterations_total", "counter", "事件循环轮数", &ReactorStats::loop_iterations},
+        {"reactor_empty_polls_total", "counter", "忙轮询中没有等到事件的等待次数", &ReactorStats::empty_polls},
+        {"reactor_queued_bytes", "gauge", "发送缓冲区中排队的字节数", &ReactorStats::queued_bytes},
+        {"reactor_tasks_in_flight", "gauge", "已交给工作线程池、尚未取回的任务数", &ReactorStats::tasks_in_flight},
+    };
+
+    std::vector<std::string> labels;
+    for (size_t i = 0; i < loops.size(); i++) {
+        labels.push_back("loop=\"" + std::to_string(i) + "\"");
+    }
+
+    out.family("reactor_connections", "gauge", "当前连接数");
+    for (size_t i = 0; i < loops.size(); i++) {
+        out.sample("reactor_connections", labels[i], loops[i].open_connections());
+    }
+    for (const Field& field : fields) {
+        out.family(field.name, field.type, field.help);
+        for (size_t i = 0; i < loops.size(); i++) {
+            out.sample(field.name, labels[i], loops[i].*field.value);
+        }
+    }
+    out.family("reactor_ready_events", "histogram", "每次唤醒的就绪事件数");
+    for (size_t i = 0; i < loops.size(); i++) {
+        out.histogram("reactor_ready_events", labels[i], loops[i].ready_events);
+    }
+    out.family("reactor_loop_busy_microseconds", "histogram", "每轮循环处理事件花费的微秒数");
+    for (size_t i = 0; i < loops.size(); i++) {
+        out.histogram("reactor_loop_busy_microseconds", labels[i], loops[i].loop_busy_us);
+    }
+}
+
+// 协议处理器基类(CRTP)
+// 派生类按需隐藏下面的回调，Reactor通过具体类型直接调用，没有虚函数开销。
+template <typename Derived>
+class ReactorHandler {
+public:
+    // 收到的数据原样发回、不需要经过on_message的协议(如echo)设为true，
+    // 允许事件循环在ReactorOptions::splice_threshold以上用splice在内核中直接转发
+    static constexpr bool passthrough = false;
+
+    // 事件循环构造时调用一次，loop是Reactor<Backend, Derived>，需要定时器等服务的处理器在这里保存它
+    template <typename Loop>
+    void on_attach(Loop& loop) { (void)loop; }
+    // 新连接建立后调用，可以在这里写入欢迎消息
+    void on_connect(Connection& conn) { (void)conn; }
+    // 收到数据后调用，in是该连接的接收缓冲区，已处理的数据应从中消费掉，回复写入conn.send_buffer；
+    // 默认用conn.codec分帧，每条完整消息调用一次on_frame
+    void on_message(Connection& conn, ChunkBuffer& in) {
+        std::string_view frame;
+        while (conn.codec.next(in, frame) == FrameCodec::FRAME) {
+            static_cast<Derived*>(this)->on_frame(conn, frame);
+            conn.codec.pop(in);
+        }
+    }
+    // 一条完整消息，frame直接指向接收缓冲区，只在本次调用内有效
+    void on_frame(Connection& conn, std::string_view frame) { (void)conn; (void)frame; }
+    // 发送缓冲区中的数据全部交给内核后调用
+    void on_drained(Connection& conn) { (void)conn; }
+    // 连接关闭前调用
+    void on_close(Connection& conn) { (void)conn; }
+
+    // 工作线程池模式下代替on_message：
+    // next_frame在事件循环线程中从接收缓冲区切出一条完整请求，没有完整请求时返回false，默认用conn.codec分帧；
+    // process在工作线程中处理一条请求并返回回复(由conn.codec编码后发送)，会被多个线程并发调用，默认原样返回
+    bool next_frame(Connection& conn, std::string& frame) {
+        std::string_view view;
+        if (conn.codec.next(conn.recv_buffer, view) != FrameCodec::FRAME) {
+            return false;
+        }
+        frame.assign(view.data(), view.size());
+        conn.codec.pop(conn.recv_buffer);
+        return true;
+    }
+    std::string process(const std::string& frame) const { return frame; }
+};
+
+// 通用的单线程事件循环：Backend负责事件多路分离，Handler负责协议逻辑
+template <typename Backend, typename Handler>
+class Reactor {
+    static_assert(std::is_base_of<ReactorHandler<Handler>, Handler>::value,
+                  "Handler must derive from ReactorHandler<Handler>");
+
+public:
+    Reactor(const std::string& host, int port, const ReactorOptions& options = ReactorOptions(),
+            const Handler& handler = Handler());
+    ~Reactor();
+
+    // 阻塞运行事件循环，直到stop()被调用或平滑关闭完成
+    void start();
+    // 下面两个函数只做原子操作和一次eventfd写入，可以在其他线程或信号处理函数中调用，
+    // 事件循环被立即唤醒，退出后在自己的线程中释放资源
+    // 立即退出，未发完的数据丢弃
+    void stop();
+    // 平滑关闭：关闭监听socket并停止读取新请求，已有连接把发送缓冲区中的回复发完后关闭；
+    // 超过drain_timeout_ms仍未发完的连接强制关闭
+    void shutdown(uint64_t drain_timeout_ms);
+
+    // 使用已有的监听socket(例如从旧进程接管来的)，必须在start()之前调用，之后由事件循环负责关闭
+    void adopt_listen_socket(int fd) { server_fd_ = fd; }
+
+    // 可以在其他线程中调用，事件循环运行时读到的是当前的计数
+    ReactorStats stats() const;
+    Handler& handler() { return handler_; }
+
+    // 定时回调，只能在事件循环线程中调用(例如在Handler的回调里)
+    TimerWheel::TimerId run_after(uint64_t delay_ms, TimerWheel::Callback cb) {
+        return timers_.schedule(delay_ms, std::move(cb));
+    }
+    bool cancel_timer(TimerWheel::TimerId id) { return timers_.cancel(id); }
+
+    // 以下函数只能在事件循环线程中调用，给在回调之外(例如定时器里)产生回复或结束连接的处理器使用
+    // 在on_message/on_connect之外向conn.send_buffer追加数据后调用，queued_before是追加前的大小
+    void commit_send(Connection& conn, size_t queued_before);
+    // 本轮循环结束后、发送缓冲区中的数据发完时关闭连接；可以在任何回调中调用
+    void close_later(Connection& conn) { closing_.push_back(conn.token()); }
+    // 处理器暂时不消费输入(例如协程在sleep中)时调用：接收缓冲区超过高水位就暂停读取，
+    // 避免对端持续发送时接收缓冲区无限增长
+    void hold_input(Connection& conn);
+    // 处理器重新等待输入时调用，恢复hold_input暂停的读取；其他原因的背压仍然有效
+    void release_input(Connection& conn);
+
+private:
+    bool edge_triggered() const { return Backend::supports_edge_triggered && options_.edge_triggered; }
+    bool drain() const { return edge_triggered() || options_.drain_on_wakeup; }
+    bool offload() const { return options_.worker_pool != nullptr; }
+
+    // 事件循环状态，只会按 IDLE -> RUNNING -> DRAINING -> STOPPING 的方向前进(可以跳过中间状态)
+    enum LoopState { IDLE, RUNNING, DRAINING, STOPPING };
+    void advance_state(int target);
+    void wake();
+
+    // 交给工作线程池的一批请求，来自同一连接一次读到的所有完整请求
+    struct OffloadTask {
+        OffloadTask* next;      // CompletionQueue使用
+        Reactor* loop;
+        uint64_t token;
+        std::vector<std::string> requests;
+        std::vector<std::string> responses;
+    };
+
+    void event_loop();
+    void cleanup();
+    void process_pending();
+    void handle_accept();
+    bool accept_one();
+    bool reject_connection();
+    void handle_read(uint64_t token);
+    void handle_write(uint64_t token);
+    void flush_writes();
+    void close_finished();
+    void close_broken();
+    void place_thread();
+    ssize_t read_into(Connection& conn);
+    ssize_t write_from(Connection& conn, size_t& requested);
+    void close_connection(Connection& conn);
+    void watch_writable(Connection& conn);
+    void schedule_send(Connection& conn);
+    void dispatch_frames(Connection& conn);
+    void close_oversized(Connection& conn);
+    bool should_splice(Connection& conn);
+    void splice_echo(Connection& conn);
+    bool flush_pipe(Connection& conn);
+    static void close_pipe(Connection& conn);
+    void begin_drain();
+    void close_drained();
+    void discard_input(Connection& conn);
+    void drain_completions();
+    static void run_task(void* arg);
+    void update_interest(Connection& conn);
+    bool apply_backpressure(Connection& conn);
+    void pause_reading(Connection& conn);
+    void resume_reading(Connection& conn);
+    void try_resume(Connection& conn);
+    void release_global_throttle();
+    void arm_stall_timer(Connection& conn);
+    void on_idle_timer(uint64_t token);
+    void on_stall_timer(uint64_t token);
+    
+    // 当前应当注册的事件：暂停读取时去掉读事件，有数据等待发送时加上写事件
+    static uint32_t interest(const Connection& conn) {
+        return (conn.read_paused ? 0u : (uint32_t)EVENT_READ) | (conn.write_armed ? (uint32_t)EVENT_WRITE : 0u);
+    }
+    bool can_resume(const Connection& conn) const {
+        return !global_throttled_ && !draining_ && conn.send_buffer.size() <= options_.send_low_water_mark
+               && conn.recv_buffer.size() <= options_.send_low_water_mark && conn.pipe_bytes == 0;
+    }
+
+    // 监听socket和完成队列eventfd的事件数据，代数固定为0，不会与任何连接冲突
+    uint64_t listen_token() const { return (uint32_t)server_fd_; }
+    uint64_t completion_token() const { return (uint32_t)completions_.fd(); }
+    uint64_t wake_token() const { return (uint32_t)wake_fd_; }
+
+    std::string host_;
+    int port_;
+    int server_fd_;
+    int spare_fd_;      // 预留的fd，fd耗尽时用来接受并关闭连接
+
+    // state_可以被任意线程推进，wake_fd_随对象创建和销毁，保证任何时候写入都是安全的
+    std::atomic<int> state_;
+    std::atomic<uint64_t> drain_timeout_ms_;
+    int wake_fd_;
+    bool draining_;     // 事件循环线程是否已进入平滑关闭阶段
+    ReactorOptions options_;
+    Backend backend_;
+    Handler handler_;
+
+    // 本循环所有连接共享的缓冲区内存池，必须在connections_之前构造、之后析构
+    ChunkPool pool_;
+    ConnectionTable connections_;
+    std::vector<ReadyEvent> ready_;
+
+    // 边沿触发模式下因达到公平上限而未读/写完的连接，以及未accept完的监听socket，
+    // 下一轮循环直接处理，不再等待新的边沿；连接以token记录，期间被关闭的会被跳过
+    std::vector<uint64_t> pending_;
+    bool accept_pending_;
+
+    // 本轮有回复数据待发送的连接
+    std::vector<uint64_t> flush_;
+    // close_later()请求关闭、等待发送缓冲区清空的连接
+    std::vector<uint64_t> closing_;
+    // 修改监听事件失败、无法再收到事件的连接；调用者在update_interest之后还会访问连接，留到本轮末尾关闭
+    std::vector<uint64_t> broken_;
+
+    // 空闲连接回收、发送超时和用户定时回调共用的时间轮；now_ms_是本轮唤醒时的时间
+    TimerWheel timers_;
+    uint64_t now_ms_;
+
+    // 所有连接发送缓冲区中排队的字节数，以及是否处于全局限流状态
+    size_t queued_bytes_;
+    bool global_throttled_;
+
+    // 工作线程池模式下的完成队列和尚未取回的任务数
+    CompletionQueue<OffloadTask> completions_;
+    size_t tasks_in_flight_;
+
+    // 最近一次等到事件的时间(微秒)，忙轮询据此决定是否继续以0超时等待
+    uint64_t last_event_us_;
+
+    ReactorStats stats_;
+
+    static const int READ_BUFFER_SIZE = 4096;
+    static const int READV_CHUNKS = 4;
+    static const int WRITEV_CHUNKS = 64;
+    static const size_t PIPE_SIZE = 1024 * 1024;   // 请求的管道容量，超过系统上限时保持默认大小
+};
+
+template <typename Backend, typename Handler>
+Reactor<Backend, Handler>::Reactor(const std::string& host, int port, const ReactorOptions& options,
+                                   const Handler& handler)
+    : host_(host), port_(port), server_fd_(-1), spare_fd_(-1), state_(IDLE), drain_timeout_ms_(0),
+      wake_fd_(-1), draining_(false), options_(options),
+      handler_(handler), connections_(pool_), accept_pending_(false),
+      timers_(options.timer_tick_ms), now_ms_(0), queued_bytes_(0), global_throttled_(false),
+      tasks_in_flight_(0), last_event_us_(0) {
+    wake_fd_ = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+    if (wake_fd_ == -1) {
+        throw std::runtime_error(std::string("eventfd failed: ") + strerror(errno));
+    }
+    handler_.on_attach(*this);
+}
+
+template <typename Backend, typename Handler>
+Reactor<Backend, Handler>::~Reactor() {
+    stop();
+    cleanup();
+    close(wake_fd_);
+}
+
+template <typename Backend, typename Handler>
+ReactorStats Reactor<Backend, Handler>::stats() const {
+    ReactorStats stats = stats_;
+    stats.wait_calls = backend_.stats().wait_calls;
+    stats.ctl_calls = backend_.stats().ctl_calls;
+    return stats;
+}
+
+template <typename Backend, typename Handler>
+void Reactor<Backend, Handler>::start() {
+    try {
+        place_thread();
+
+        if (server_fd_ == -1) {
+            SocketAddress addr = SocketAddress::resolve(host_, port_);
+            server_fd_ = create_listen_socket(addr, options_.reuse_port, options_.listen_backlog);
+            LOG_INFO("Echo服务器启动在 " << addr.to_string() << " (" << Backend::name << ")");
+        } else {
+            set_non_blocking(server_fd_);
+            LOG_INFO("Echo服务器使用已有的监听socket (fd: " << server_fd_ << ", " << Backend::name << ")");
+        }
+        // 接管来的监听socket也重新设置，新进程的参数为准
+        apply_listen_profile(server_fd_, options_.tcp);
+
+        spare_fd_ = open("/dev/null", O_RDONLY | O_CLOEXEC);
+
+        backend_.open(edge_triggered());
+        // 启动时的fd加不进后端说明环境有问题，直接失败
+        if (!backend_.add(server_fd_, EVENT_READ, listen_token())
+            || !backend_.add(wake_fd_, EVENT_READ, wake_token())) {
+            throw std::runtime_error(std::string("Failed to watch listen socket: ") + strerror(errno));
+        }
+        if (offload()) {
+            completions_.open();
+            if (!backend_.add(completions_.fd(), EVENT_READ, completion_token())) {
+                throw std::runtime_error(std::string("Failed to watch completion queue: ") + strerror(errno));
+            }
+        }
+
+        // 启动前已经被要求关闭时直接退出
+        int expected = IDLE;
+        if (state_.compare_exchange_strong(expected, RUNNING)) {
+            event_loop();
+        }
+
+        LOG_INFO("事件循环退出: 暂停读取 " << stats_.read_pauses.value() << " 次, 全局限流 "
+                 << stats_.global_throttles.value() << " 次, 空闲超时 " << stats_.idle_closes.value()
+                 << " 个, 发送超时 " << stats_.stall_closes.value() << " 个, 交给工作线程 "
+                 << stats_.offloaded_tasks.value() << " 批, splice直通 " << stats_.spliced_bytes.value()
+                 << " 字节");
+    } catch (const std::exception& e) {
+        LOG_ERROR("启动服务器失败: " << e.what());
+    }
+    cleanup();
+}
+
+template <typename Backend, typename Handler>
+void Reactor<Backend, Handler>::stop() {
+    advance_state(STOPPING);
+    wake();
+}
+
+template <typename Backend, typename Handler>
+void Reactor<Backend, Handler>::shutdown(uint64_t drain_timeout_ms) {
+    drain_timeout_ms_.store(drain_timeout_ms);
+    advance_state(DRAINING);
+    wake();
+}
+
+template <typename Backend, typename Handler>
+void Reactor<Backend, Handler>::advance_state(int target) {
+    // 状态只能前进：已经在关闭中的循环不会被一次较晚的shutdown()拉回排空阶段
+    int current = state_.load();
+    while (current < target && !state_.compare_exchange_weak(current, target)) {
+    }
+}
+
+template <typename Backend, typename Handler>
+void Reactor<Backend, Handler>::wake() {
+    // eventfd计数不会溢出到需要关心的程度，写失败(计数已满)也说明循环已被唤醒
+    uint64_t one = 1;
+    ssize_t n = write(wake_fd_, &one, sizeof(one));
+    (void)n;
+}
+
+template <typename Backend, typename Handler>
+void Reactor<Backend, Handler>::cleanup() {
+    // 关闭所有客户端连接
+    connections_.for_each([this](Connection& conn) {
+        timers_.cancel(conn.idle_timer);
+        timers_.cancel(conn.stall_timer);
+        handler_.on_close(conn);
+        close_pipe(conn);
+        close(conn.fd);
+        connections_.destroy(&conn);
+        stats_.closed_connections++;
+    });
+    pending_.clear();
+    flush_.clear();
+    closing_.clear();
+    broken_.clear();
+    accept_pending_ = false;
+    queued_bytes_ = 0;
+    global_throttled_ = false;
+
+    // 任务持有指向本对象的指针，等工作线程全部交回后才能关闭完成队列；连接已关闭，结果直接丢弃
+    if (completions_.fd() != -1) {
+        while (tasks_in_flight_ > 0) {
+            completions_.wait(100);
+            drain_completions();
+        }
+        backend_.remove(completions_.fd());
+        completions_.close();
+    }
+
+    // 关闭后端和服务器socket
+    backend_.close();
+
+    if (spare_fd_ != -1) {
+        close(spare_fd_);
+        spare_fd_ = -1;
+    }
+
+    if (server_fd_ != -1) {
+        close(server_fd_);
+        server_fd_ = -1;
+        LOG_INFO("服务器已关闭");
+    }
+}
+
+template <typename Backend, typename Handler>
+void Reactor<Backend, Handler>::event_loop() {
+    LOG_INFO("进入事件循环...");
+
+    now_ms_ = TimerWheel::now_ms();
+    timers_.advance(now_ms_);
+
+    while (true) {
+        int state = state_.load();
+        if (state == STOPPING) {
+            break;
+        }
+        if (state == DRAINING) {
+            if (!draining_) {
+                begin_drain();
+            }
+            close_drained();
+            if (connections_.size() == 0 && tasks_in_flight_ == 0) {
+                LOG_INFO("平滑关闭完成，所有连接已发送完毕");
+                break;
+            }
+        }
+
+        // 等待事件；有未处理完的连接或上一轮定时回调产生的回复时不阻塞，有定时器时最多等到下一个定时器到期
+        bool has_pending = accept_pending_ || !pending_.empty() || !flush_.empty();
+        int timeout = has_pending ? 0 : options_.poll_timeout_ms;
+        int next_timer = timers_.next_timeout_ms();
+        if (next_timer >= 0 && next_timer < timeout) {
+            timeout = next_timer;
+        }
+        // 忙轮询窗口内不睡眠，窗口从最近一次有事件时算起，负载停下来后自动回到阻塞等待
+        bool spinning = options_.busy_poll_us > 0 && monotonic_us() - last_event_us_ < options_.busy_poll_us;
+        if (spinning) {
+            timeout = 0;
+        }
+
+        ready_.clear();
+        int nfds = backend_.wait(timeout, ready_);
+        // 与TimerWheel::now_ms()同一时钟，顺便用于统计本轮处理耗时
+        uint64_t busy_begin_us = monotonic_us();
+        now_ms_ = busy_begin_us / 1000;
+        if (nfds > 0) {
+            last_event_us_ = busy_begin_us;
+        } else if (spinning && nfds == 0) {
+            stats_.empty_polls++;
+            // 独占CPU时没有别的可运行线程，sched_yield立即返回；CPU被共享时把时间片让给同一CPU上的其他线程
+            sched_yield();
+        }
+
+        if (nfds == -1) {
+            if (errno == EINTR) {
+                continue;  // 被信号中断，继续
+            }
+            LOG_ERROR(Backend::name << " wait error: " << strerror(errno));
+            break;
+        }
+
+        // 处理所有就绪的事件
+        for (const ReadyEvent& ev : ready_) {
+            if (ev.data == listen_token()) {
+                // 新连接
+                handle_accept();
+                continue;
+            }
+            if (ev.data == wake_token()) {
+                // stop()/shutdown()的唤醒，清掉计数后回到循环开头检查状态
+                uint64_t count;
+                ssize_t n = read(wake_fd_, &count, sizeof(count));
+                (void)n;
+                continue;
+            }
+            if (offload() && ev.data == completion_token()) {
+                // 工作线程交回的结果
+                drain_completions();
+                continue;
+            }
+
+            // 连接在本轮已被关闭(fd可能已被新连接复用)时丢弃过期事件
+            Connection* conn = connections_.find_token(ev.data);
+            if (conn == nullptr) {
+                continue;
+            }
+
+            // 检查错误事件
+            if (ev.events & EVENT_ERROR) {
+                LOG_WARN(Backend::name << "错误事件发生在fd " << conn->fd);
+                close_connection(*conn);
+                continue;
+            }
+
+            // 客户端事件
+            if (ev.events & EVENT_READ) {
+                handle_read(ev.data);
+            }
+            if (ev.events & EVENT_WRITE) {
+                handle_write(ev.data);
+            }
+        }
+
+        if (has_pending) {
+            process_pending();
+        }
+
+        if (!flush_.empty()) {
+            flush_writes();
+        }
+
+        // 处理到期的定时器
+        timers_.advance(now_ms_);
+
+        if (!broken_.empty()) {
+            close_broken();
+        }
+
+        if (!closing_.empty()) {
+            close_finished();
+        }
+
+        stats_.loop_iterations++;
+        stats_.ready_events.observe(nfds);
+        stats_.loop_busy_us.observe(monotonic_us() - busy_begin_us);
+        stats_.queued_bytes.set(queued_bytes_);
+        stats_.tasks_in_flight.set(tasks_in_flight_);
+    }
+}
+
+template <typename Backend, typename Handler>
+void Reactor<Backend, Handler>::begin_drain() {
+    draining_ = true;
+
+    // 停止接受新连接；监听socket如果已经交给新进程，那边的引用不受影响
+    if (server_fd_ != -1) {
+        backend_.remove(server_fd_);
+        close(server_fd_);
+        server_fd_ = -1;
+    }
+    accept_pending_ = false;
+
+    // 停止读取新请求，已读到的请求照常处理
+    connections_.for_each([this](Connection& conn) {
+        if (!conn.read_paused) {
+            conn.read_paused = true;
+            update_interest(conn);
+        }
+    });
+
+    uint64_t timeout = drain_timeout_ms_.load();
+    LOG_INFO("开始平滑关闭: 停止接受新连接，等待 " << connections_.size() << " 个连接发送完毕，最多 "
+             << timeout << " 毫秒");
+    timers_.schedule(timeout, [this]() {
+        LOG_WARN("平滑关闭超时，强制关闭剩余的 " << connections_.size() << " 个连接");
+        advance_state(STOPPING);
+    });
+}
+
+template <typename Backend, typename Handler>
+void Reactor<Backend, Handler>::close_drained() {
+    // 回复发完的连接先只关闭写方向：直接close时如果接收队列里还有对端数据，内核会发RST，
+    // 对端可能因此丢掉还没读的回复。之后恢复读取并丢弃数据，等对端关闭或超时。
+    connections_.for_each([this](Connection& conn) {
+        if (!conn.half_closed && conn.send_buffer.empty() && conn.pipe_bytes == 0 && !conn.task_in_flight) {
+            ::shutdown(conn.fd, SHUT_WR);
+            conn.half_closed = true;
+            conn.read_paused = false;
+            update_interest(conn);
+        }
+    });
+}
+
+template <typename Backend, typename Handler>
+void Reactor<Backend, Handler>::discard_input(Connection& conn) {
+    char buffer[READ_BUFFER_SIZE];
+    while (true) {
+        stats_.read_calls++;
+        ssize_t bytes_read = recv(conn.fd, buffer, sizeof(buffer), 0);
+        if (bytes_read > 0) {
+            continue;
+        }
+        if (bytes_read < 0 && (errno == EWOULDBLOCK || errno == EAGAIN)) {
+            return;
+        }
+        close_connection(conn);
+        return;
+    }
+}
+
+template <typename Backend, typename Handler>
+void Reactor<Backend, Handler>::process_pending() {
+    if (accept_pending_) {
+        accept_pending_ = false;
+        handle_accept();
+    }
+
+    // handle_read/handle_write可能再次加入pending_，先交换出来
+    std::vector<uint64_t> pending;
+    pending.swap(pending_);
+    for (uint64_t token : pending) {
+        handle_read(token);
+        Connection* conn = connections_.find_token(token);
+        if (conn && !conn->send_buffer.empty()) {
+            handle_write(token);
+        }
+    }
+}
+
+template <typename Backend, typename Handler>
+void Reactor<Backend, Handler>::handle_accept() {
+    // 每次唤醒循环accept直到EAGAIN或达到上限，连接风暴时一次epoll_wait处理一批连接
+    for (int i = 0; i < options_.max_accepts_per_wakeup; i++) {
+        if (!accept_one()) {
+            return;
+        }
+    }
+
+    if (edge_triggered()) {
+        // 达到单次上限，可能还有连接在排队，下一轮继续
+        accept_pending_ = true;
+    }
+}
+
+template <typename Backend, typename Handler>
+bool Reactor<Backend, Handler>::accept_one() {
+    SocketAddress client_addr;
+
+    // accept4直接得到非阻塞的fd，不再需要两次fcntl
+    stats_.accept_calls++;
+    int client_fd = accept4(server_fd_, client_addr.data(), client_addr.size_ptr(), SOCK_NONBLOCK | SOCK_CLOEXEC);
+
+    if (client_fd < 0) {
+        if (errno == EMFILE || errno == ENFILE) {
+            return reject_connection();
+        }
+        if (errno != EWOULDBLOCK && errno != EAGAIN && errno != ECONNABORTED) {
+            LOG_ERROR("Accept error: " << strerror(errno));
+        }
+        // 对端在accept之前已经断开的连接跳过，继续处理队列里的其他连接
+        return errno == ECONNABORTED;
+    }
+
+    if (!client_addr.is_unix()) {
+        if (options_.tcp.no_delay || options_.tcp.quick_ack) {
+            apply_connection_profile(client_fd, options_.tcp);
+            stats_.sockopt_calls += (int)options_.tcp.no_delay + (int)options_.tcp.quick_ack;
+        }
+        if (options_.busy_poll_us > 0) {
+            // 超过net.core.busy_read的值需要CAP_NET_ADMIN，设置失败时只是没有设备轮询
+            int busy_poll = (int)options_.busy_poll_us;
+            setsockopt(client_fd, SOL_SOCKET, SO_BUSY_POLL, &busy_poll, sizeof(busy_poll));
+            stats_.sockopt_calls++;
+        }
+    }
+
+    // 创建客户端数据
+    Connection* conn = connections_.create(client_fd, client_addr, options_.send_high_water_mark);
+    stats_.accepted_connections++;
+    conn->codec = FrameCodec(options_.frame_mode, options_.max_frame_size);
+
+    LOG_DEBUG("接受来自 " << format_address(client_addr) << " 的新连接 (fd: " << client_fd << ")");
+
+    handler_.on_connect(*conn);
+    queued_bytes_ += conn->send_buffer.size();
+
+    conn->last_active_ms = now_ms_;
+    if (options_.idle_timeout_ms > 0) {
+        uint64_t token = conn->token();
+        conn->idle_timer = timers_.schedule(options_.idle_timeout_ms, [this, token]() { on_idle_timer(token); });
+    }
+
+    // 新连接的内核发送缓冲区是空的，欢迎消息直接发送，通常一次就能发完，
+    // 这样只需注册读事件，不用先注册写事件、发完再MOD掉，每个连接只有一次epoll_ctl
+    if (!conn->send_buffer.empty()) {
+        size_t requested = 0;
+        ssize_t bytes_sent = write_from(*conn, requested);
+        if (bytes_sent > 0) {
+            conn->send_buffer.consume(bytes_sent);
+            stats_.bytes_written += bytes_sent;
+            queued_bytes_ -= bytes_sent;
+        } else if (errno != EWOULDBLOCK && errno != EAGAIN) {
+            LOG_DEBUG("向新连接 " << client_fd << " 发送欢迎消息失败: " << strerror(errno));
+            close_connection(*conn);
+            return true;
+        }
+    }
+
+    if (!conn->send_buffer.empty()) {
+        conn->write_armed = true;
+        conn->last_write_ms = now_ms_;
+        arm_stall_timer(*conn);
+    }
+    conn->registered_events = interest(*conn);
+    if (!backend_.add(client_fd, conn->registered_events, conn->token())) {
+        // select后端fd超过FD_SETSIZE、epoll_ctl失败时只关闭这个连接，和fd耗尽时一样计入拒绝数
+        stats_.accept_rejects++;
+        LOG_WARN("无法监听新连接 (fd: " << client_fd << "): " << strerror(errno) << "，关闭连接");
+        close_connection(*conn);
+    }
+    return true;
+}
+
+template <typename Backend, typename Handler>
+bool Reactor<Backend, Handler>::reject_connection() {
+    // fd耗尽时连接留在监听队列里，水平触发会不停唤醒。用预留的fd腾出位置，
+    // 接受后立即关闭，让客户端尽快得到失败而不是超时，然后重新预留
+    if (spare_fd_ == -1) {
+        LOG_ERROR("Accept error: " << strerror(errno));
+        return false;
+    }
+    close(spare_fd_);
+    // fd不足时即使队列为空accept也先报EMFILE，这里才能区分是否真有连接在排队
+    int client_fd = accept4(server_fd_, nullptr, nullptr, SOCK_CLOEXEC);
+    if (client_fd != -1) {
+        close(client_fd);
+        stats_.accept_rejects++;
+        LOG_WARN("文件描述符耗尽，拒绝新连接 (已拒绝 " << stats_.accept_rejects.value() << " 个)");
+    }
+    spare_fd_ = open("/dev/null", O_RDONLY | O_CLOEXEC);
+    return client_fd != -1 && spare_fd_ != -1;
+}
+
+template <typename Backend, typename Handler>
+ssize_t Reactor<Backend, Handler>::read_into(Connection& conn) {
+    stats_.read_calls++;
+
+    if (!options_.vectored_io) {
+        char buffer[READ_BUFFER_SIZE];
+        ssize_t bytes_read = recv(conn.fd, buffer, sizeof(buffer), 0);
+        if (bytes_read > 0) {
+            conn.recv_buffer.append(buffer, bytes_read);
+
+            // 输出接收到的数据
+            LOG_TRACE("从客户端 " << conn.fd << " 收到 " << bytes_read
+                      << " 字节: " << std::string(buffer, bytes_read));
+        }
+        return bytes_read;
+    }
+
+    // 直接读进接收缓冲区的多个数据块
+    struct iovec iov[READV_CHUNKS];
+    int iovcnt = conn.recv_buffer.prepare_iovec(iov, READV_CHUNKS);
+    ssize_t bytes_read = readv(conn.fd, iov, iovcnt);
+    conn.recv_buffer.commit(bytes_read > 0 ? bytes_read : 0);
+
+    if (bytes_read > 0) {
+        LOG_TRACE("从客户端 " << conn.fd << " 收到 " << bytes_read << " 字节");
+    }
+    return bytes_read;
+}
+
+template <typename Backend, typename Handler>
+ssize_t Reactor<Backend, Handler>::write_from(Connection& conn, size_t& requested) {
+    stats_.write_calls++;
+
+    if (!options_.vectored_io) {
+        requested = conn.send_buffer.front_size();
+        // 后面还有数据块时让内核等它们拼成满报文，最后一块不带MSG_MORE，立即推出
+        int flags = 0;
+        if (options_.tcp.batching == ReplyBatching::MSG_MORE && requested < conn.send_buffer.size()
+            && !conn.addr.is_unix()) {
+            flags = MSG_MORE;
+        }
+        return send(conn.fd, conn.send_buffer.front_data(), requested, flags);
+    }
+
+    // 一次writev发出所有排队的数据块
+    struct iovec iov[WRITEV_CHUNKS];
+    int iovcnt = conn.send_buffer.fill_iovec(iov, WRITEV_CHUNKS);
+    requested = 0;
+    for (int i = 0; i < iovcnt; i++) {
+        requested += iov[i].iov_len;
+    }
+    return writev(conn.fd, iov, iovcnt);
+}
+
+template <typename Backend, typename Handler>
+void Reactor<Backend, Handler>::handle_read(uint64_t token) {
+    Connection* found = connections_.find_token(token);
+    if (found == nullptr) {
+        return;
+    }
+
+    Connection& conn = *found;
+    if (conn.half_closed) {
+        discard_input(conn);
+        return;
+    }
+    if (should_splice(conn)) {
+        splice_echo(conn);
+        return;
+    }
+
+    size_t total_read = 0;
+
+    while (!conn.read_paused) {
+        ssize_t bytes_read = read_into(conn);
+
+        if (bytes_read > 0) {
+            stats_.bytes_read += bytes_read;
+            total_read += bytes_read;
+            conn.last_active_ms = now_ms_;
+
+            if (offload()) {
+                // 切出完整请求交给工作线程池；上一批还没处理完时先留在接收缓冲区
+                if (!conn.task_in_flight) {
+                    dispatch_frames(conn);
+                }
+                if (conn.codec.failed()) {
+                    close_oversized(conn);
+                    return;
+                }
+                // 工作线程跟不上时请求堆在接收缓冲区，超过高水位同样暂停读取；
+                // 没有任务在处理时缓冲区里只有半条消息，大小由max_frame_size限制
+                if (conn.task_in_flight && conn.recv_buffer.size() >= options_.send_high_water_mark) {
+                    pause_reading(conn);
+                    break;
+                }
+                if (apply_backpressure(conn)) {
+                    break;
+                }
+            } else {
+                // 交给协议处理器
+                size_t queued_before = conn.send_buffer.size();
+                handler_.on_message(conn, conn.recv_buffer);
+                queued_bytes_ += conn.send_buffer.size() - queued_before;
+                if (conn.codec.failed()) {
+                    close_oversized(conn);
+                    return;
+                }
+
+                // 回复积压过多时停止读取，让写事件把数据发出去
+                if (apply_backpressure(conn)) {
+                    break;
+                }
+            }
+
+            // 默认每次只读一次，剩余数据由下一次事件通知处理
+            if (!drain()) {
+                break;
+            }
+
+            // 达到公平上限，避免饿死其他连接；边沿触发模式下留到下一轮继续读
+            if (total_read >= options_.max_io_bytes_per_wakeup) {
+                if (edge_triggered()) {
+                    pending_.push_back(token);
+                }
+                break;
+            }
+
+        } else if (bytes_read == 0) {
+            // 客户端关闭连接
+            LOG_DEBUG("客户端 " << conn.fd << " 断开连接");
+            close_connection(conn);
+            return;
+        } else {
+            if (errno != EWOULDBLOCK && errno != EAGAIN) {
+                LOG_WARN("从客户端 " << conn.fd << " 读取错误: " << strerror(errno));
+                close_connection(conn);
+                return;
+            }
+            // 没有更多数据可读
+            break;
+        }
+    }
+
+    schedule_send(conn);
+}
+
+template <typename Backend, typename Handler>
+void Reactor<Backend, Handler>::schedule_send(Connection& conn) {
+    if (conn.send_buffer.empty()) {
+        return;
+    }
+
+    // 已经在等待可写事件时由handle_write继续发送
+    if (conn.write_armed) {
+        return;
+    }
+
+    // 本轮循环结束时直接尝试发送，同一连接在本轮产生的所有回复一起发出；
+    // 只有发不完才注册写事件，回复能一次发完的请求不需要两次epoll_ctl去开关写事件
+    if (!conn.flush_queued) {
+        conn.flush_queued = true;
+        flush_.push_back(conn.token());
+    }
+}
+
+template <typename Backend, typename Handler>
+void Reactor<Backend, Handler>::dispatch_frames(Connection& conn) {
+    OffloadTask* task = new OffloadTask();
+    std::string frame;
+    while (handler_.next_frame(conn, frame)) {
+        task->requests.push_back(std::move(frame));
+        frame.clear();
+    }
+    if (task->requests.empty()) {
+        delete task;
+        return;
+    }
+
+    task->next = nullptr;
+    task->loop = this;
+    task->token = conn.token();
+    conn.task_in_flight = true;
+    tasks_in_flight_++;
+    stats_.offloaded_tasks++;
+
+    if (!tpool_add_work(options_.worker_pool, &Reactor::run_task, task)) {
+        // 分配失败时退回在事件循环线程中处理，结果同样经完成队列交回
+        LOG_WARN("tpool_add_work失败，在事件循环线程中处理fd " << conn.fd << " 的请求");
+        run_task(task);
+    }
+}
+
+template <typename Backend, typename Handler>
+void Reactor<Backend, Handler>::close_oversized(Connection& conn) {
+    LOG_WARN("客户端 " << conn.fd << " 的消息超过 " << options_.max_frame_size << " 字节，关闭连接");
+    close_connection(conn);
+}
+
+template <typename Backend, typename Handler>
+void Reactor<Backend, Handler>::run_task(void* arg) {
+    // 在工作线程中执行，只能访问任务自身和const的process
+    OffloadTask* task = static_cast<OffloadTask*>(arg);
+    const Handler& handler = task->loop->handler_;
+    task->responses.reserve(task->requests.size());
+    for (const std::string& request : task->requests) {
+        task->responses.push_back(handler.process(request));
+    }
+    task->loop->completions_.push(task);
+}
+
+template <typename Backend, typename Handler>
+void Reactor<Backend, Handler>::drain_completions() {
+    OffloadTask* task = completions_.pop_all();
+    while (task) {
+        OffloadTask* next = task->next;
+        tasks_in_flight_--;
+
+        Connection* conn = connections_.find_token(task->token);
+        if (conn) {
+            // 连接仍然存在时把回复追加到发送缓冲区，再把处理期间到达的请求继续交出去
+            conn->task_in_flight = false;
+            size_t queued_before = conn->send_buffer.size();
+            for (const std::string& response : task->responses) {
+                conn->codec.encode(conn->send_buffer, response);
+            }
+            queued_bytes_ += conn->send_buffer.size() - queued_before;
+
+            apply_backpressure(*conn);
+            if (conn->read_paused) {
+                try_resume(*conn);
+            } else {
+                dispatch_frames(*conn);
+            }
+            if (conn->codec.failed()) {
+                close_oversized(*conn);
+            } else {
+                schedule_send(*conn);
+            }
+        }
+
+        delete task;
+        task = next;
+    }
+}
+
+template <typename Backend, typename Handler>
+bool Reactor<Backend, Handler>::should_splice(Connection& conn) {
+    if (!Handler::passthrough || options_.splice_threshold == 0 || offload()
+        || conn.codec.mode() != FrameMode::RAW || conn.read_paused) {
+        return false;
+    }
+    // 缓冲区里还有数据时走普通路径，保证回写顺序
+    if (!conn.recv_buffer.empty() || !conn.send_buffer.empty() || conn.pipe_bytes > 0) {
+        return false;
+    }
+
+    int available = 0;
+    if (ioctl(conn.fd, FIONREAD, &available) == -1 || (size_t)available < options_.splice_threshold) {
+        return false;
+    }
+
+    if (conn.pipe_fds[0] == -1) {
+        if (pipe2(conn.pipe_fds, O_NONBLOCK | O_CLOEXEC) == -1) {
+            LOG_WARN("创建管道失败: " << strerror(errno));
+            conn.pipe_fds[0] = conn.pipe_fds[1] = -1;
+            return false;
+        }
+        // 管道越大每次splice搬运的数据越多；超过/proc/sys/fs/pipe-max-size时失败，保持默认64KB
+        fcntl(conn.pipe_fds[1], F_SETPIPE_SZ, (int)PIPE_SIZE);
+    }
+    return true;
+}
+
+template <typename Backend, typename Handler>
+void Reactor<Backend, Handler>::splice_echo(Connection& conn) {
+    uint64_t token = conn.token();
+    size_t total_read = 0;
+
+    while (true) {
+        // socket -> 管道 -> socket，数据只在内核页之间移动
+        stats_.read_calls++;
+        ssize_t bytes_read = splice(conn.fd, nullptr, conn.pipe_fds[1], nullptr, PIPE_SIZE,
+                                    SPLICE_F_MOVE | SPLICE_F_NONBLOCK);
+        if (bytes_read == 0) {
+            LOG_DEBUG("客户端 " << conn.fd << " 断开连接");
+            close_connection(conn);
+            return;
+        }
+        if (bytes_read < 0) {
+            if (errno != EWOULDBLOCK && errno != EAGAIN) {
+                LOG_WARN("从客户端 " << conn.fd << " splice错误: " << strerror(errno));
+                close_connection(conn);
+                return;
+            }
+            break;
+        }
+
+        conn.pipe_bytes += bytes_read;
+        stats_.bytes_read += bytes_read;
+        stats_.spliced_bytes += bytes_read;
+        total_read += bytes_read;
+        conn.last_active_ms = now_ms_;
+
+        if (!flush_pipe(conn)) {
+            return;
+        }
+        if (conn.pipe_bytes > 0) {
+            // 内核发送缓冲区已满，管道清空之前不再读取
+            pause_reading(conn);
+            if (!conn.write_armed) {
+                watch_writable(conn);
+            }
+            return;
+        }
+
+        if (!drain()) {
+            break;
+        }
+        if (total_read >= options_.max_io_bytes_per_wakeup) {
+            if (edge_triggered()) {
+                pending_.push_back(token);
+            }
+            break;
+        }
+    }
+}
+
+template <typename Backend, typename Handler>
+bool Reactor<Backend, Handler>::flush_pipe(Connection& conn) {
+    while (conn.pipe_bytes > 0) {
+        stats_.write_calls++;
+        ssize_t bytes_sent = splice(conn.pipe_fds[0], nullptr, conn.fd, nullptr, conn.pipe_bytes,
+                                    SPLICE_F_MOVE | SPLICE_F_NONBLOCK);
+        if (bytes_sent > 0) {
+            conn.pipe_bytes -= bytes_sent;
+            stats_.bytes_written += bytes_sent;
+            conn.last_active_ms = now_ms_;
+            conn.last_write_ms = now_ms_;
+            continue;
+        }
+        if (bytes_sent < 0 && (errno == EWOULDBLOCK || errno == EAGAIN)) {
+            return true;
+        }
+        LOG_WARN("向客户端 " << conn.fd << " splice错误: " << strerror(errno));
+        close_connection(conn);
+        return false;
+    }
+    return true;
+}
+
+template <typename Backend, typename Handler>
+void Reactor<Backend, Handler>::close_pipe(Connection& conn) {
+    if (conn.pipe_fds[0] != -1) {
+        close(conn.pipe_fds[0]);
+        close(conn.pipe_fds[1]);
+        conn.pipe_fds[0] = conn.pipe_fds[1] = -1;
+    }
+}
+
+template <typename Backend, typename Handler>
+void Reactor<Backend, Handler>::flush_writes() {
+    std::vector<uint64_t> flush;
+    flush.swap(flush_);
+
+    for (uint64_t token : flush) {
+        Connection* conn = connections_.find_token(token);
+        if (conn == nullptr) {
+            continue;
+        }
+        conn->flush_queued = false;
+
+        // 已经在等待可写事件的连接由handle_write处理
+        if (conn->write_armed) {
+            continue;
+        }
+
+        handle_write(token);
+
+        // 没有一次发完，监听写事件等内核发送缓冲区腾出空间
+        conn = connections_.find_token(token);
+        if (conn && !conn->send_buffer.empty() && !conn->write_armed) {
+            watch_writable(*conn);
+        }
+    }
+}
+
+template <typename Backend, typename Handler>
+void Reactor<Backend, Handler>::commit_send(Connection& conn, size_t queued_before) {
+    queued_bytes_ += conn.send_buffer.size() - queued_before;
+    schedule_send(conn);
+}
+
+template <typename Backend, typename Handler>
+void Reactor<Backend, Handler>::hold_input(Connection& conn) {
+    if (!conn.read_paused && conn.recv_buffer.size() >= options_.send_high_water_mark) {
+        pause_reading(conn);
+    }
+}
+
+template <typename Backend, typename Handler>
+void Reactor<Backend, Handler>::release_input(Connection& conn) {
+    // 不检查接收缓冲区：等待一条完整消息时缓冲区里的半条消息可能超过低水位，由max_frame_size限制
+    if (conn.read_paused && !conn.half_closed && !global_throttled_ && !draining_
+        && conn.send_buffer.size() <= options_.send_low_water_mark && conn.pipe_bytes == 0) {
+        resume_reading(conn);
+    }
+}
+
+template <typename Backend, typename Handler>
+void Reactor<Backend, Handler>::close_finished() {
+    // 数据还没发完的连接留到以后的轮次，写事件会把它发完；发送停滞由stall定时器兜底
+    std::vector<uint64_t> closing;
+    closing.swap(closing_);
+    for (uint64_t token : closing) {
+        Connection* conn = connections_.find_token(token);
+        if (conn == nullptr) {
+            continue;
+        }
+        if (conn->send_buffer.empty() && conn->pipe_bytes == 0) {
+            close_connection(*conn);
+        } else {
+            closing_.push_back(token);
+        }
+    }
+}
+
+template <typename Backend, typename Handler>
+void Reactor<Backend, Handler>::close_broken() {
+    // 同一个连接可能被记录多次，第一次关闭后token失效，之后的查找返回空
+    std::vector<uint64_t> broken;
+    broken.swap(broken_);
+    for (uint64_t token : broken) {
+        Connection* conn = connections_.find_token(token);
+        if (conn != nullptr) {
+            close_connection(*conn);
+        }
+    }
+}
+
+template <typename Backend, typename Handler>
+void Reactor<Backend, Handler>::place_thread() {
+    // 放置失败只影响延迟，不影响正确性，记录后照常运行
+    if (!options_.cpu_affinity.empty()) {
+        try {
+            pin_current_thread(options_.cpu_affinity);
+            // 绑定立即生效，让线程迁移到目标CPU上再设置内存策略
+            sched_yield();
+            LOG_INFO("事件循环线程绑定到CPU " << current_cpu() << " (NUMA节点 " << current_numa_node() << ")");
+        } catch (const std::exception& e) {
+            LOG_WARN("绑定CPU失败: " << e.what());
+        }
+    }
+    if (options_.numa_local) {
+        try {
+            use_local_memory();
+        } catch (const std::exception& e) {
+            LOG_WARN("设置NUMA本地内存策略失败: " << e.what());
+        }
+    }
+    if (options_.busy_poll_us > 0) {
+        LOG_INFO("忙轮询: 空闲 " << options_.busy_poll_us << " 微秒后退回阻塞等待");
+    }
+}
+
+template <typename Backend, typename Handler>
+void Reactor<Backend, Handler>::handle_write(uint64_t token) {
+    Connection* found = connections_.find_token(token);
+    if (found == nullptr) {
+        return;
+    }
+
+    Connection& conn = *found;
+    size_t total_sent = 0;
+
+    // 先发出管道里直通的数据，发送缓冲区只在管道清空后才会有新数据
+    if (conn.pipe_bytes > 0) {
+        if (!flush_pipe(conn) || conn.pipe_bytes > 0) {
+            return;
+        }
+        if (conn.read_paused) {
+            try_resume(conn);
+        }
+    }
+
+    // TCP_CORK模式下多个数据块在塞子下发出，函数返回时拔掉，尾部不满一个报文的数据立即推出；
+    // 向量化I/O本来就是一次writev，不需要
+    struct Uncork {
+        int fd;
+        bool active;
+        Counter& calls;
+        ~Uncork() {
+            if (active) {
+                set_cork(fd, false);
+                calls++;
+            }
+        }
+    } uncork = {conn.fd, false, stats_.sockopt_calls};
+    if (options_.tcp.batching == ReplyBatching::CORK && !options_.vectored_io && !conn.addr.is_unix()
+        && conn.send_buffer.size() > conn.send_buffer.front_size()) {
+        set_cork(conn.fd, true);
+        stats_.sockopt_calls++;
+        uncork.active = true;
+    }
+
+    while (!conn.send_buffer.empty()) {
+        size_t requested = 0;
+        ssize_t bytes_sent = write_from(conn, requested);
+
+        if (bytes_sent > 0) {
+            LOG_TRACE("向客户端 " << conn.fd << " 发送 " << bytes_sent << " 字节");
+            conn.send_buffer.consume(bytes_sent);
+            stats_.bytes_written += bytes_sent;
+            queued_bytes_ -= bytes_sent;
+            total_sent += bytes_sent;
+            conn.last_active_ms = now_ms_;
+            conn.last_write_ms = now_ms_;
+
+            if (global_throttled_ && queued_bytes_ <= options_.global_low_water_mark) {
+                release_global_throttle();
+            }
+            // 发送缓冲区降到低水位以下，恢复被暂停的读取
+            if (conn.read_paused) {
+                try_resume(conn);
+            }
+
+            // 水平触发模式下内核发送缓冲区已满时不再尝试，等待下一次可写事件
+            if (!edge_triggered() && (size_t)bytes_sent < requested) {
+                break;
+            }
+
+            // 达到公平上限，留到下一轮继续写；水平触发模式下由下一次可写事件继续
+            if (total_sent >= options_.max_io_bytes_per_wakeup && !conn.send_buffer.empty()) {
+                if (edge_triggered()) {
+                    pending_.push_back(token);
+                }
+                return;
+            }
+        } else {
+            if (errno != EWOULDBLOCK && errno != EAGAIN) {
+                LOG_WARN("向客户端 " << conn.fd << " 发送错误: " << strerror(errno));
+                uncork.active = false;
+                close_connection(conn);
+            }
+            // 如果是EWOULDBLOCK，保持当前的事件监听，下次再尝试发送
+            return;
+        }
+    }
+
+    // 所有数据都已发送，不再监听写事件
+    if (conn.send_buffer.empty()) {
+        if (conn.write_armed) {
+            conn.write_armed = false;
+            update_interest(conn);
+        }
+        handler_.on_drained(conn);
+    }
+}
+
+template <typename Backend, typename Handler>
+void Reactor<Backend, Handler>::watch_writable(Connection& conn) {
+    conn.write_armed = true;
+    conn.last_write_ms = now_ms_;
+    update_interest(conn);
+    arm_stall_timer(conn);
+}
+
+template <typename Backend, typename Handler>
+void Reactor<Backend, Handler>::update_interest(Connection& conn) {
+    // 同一轮里暂停又恢复读取、或者状态变化后事件恰好不变时，不必再调用epoll_ctl
+    uint32_t events = interest(conn);
+    if (events == conn.registered_events) {
+        return;
+    }
+    conn.registered_events = events;
+    if (!backend_.modify(conn.fd, events, conn.token())) {
+        // 和add失败时一样只关闭这个连接，不影响同一事件循环上的其他连接
+        LOG_WARN("无法修改连接的监听事件 (fd: " << conn.fd << "): " << strerror(errno) << "，关闭连接");
+        broken_.push_back(conn.token());
+    }
+}
+
+template <typename Backend, typename Handler>
+bool Reactor<Backend, Handler>::apply_backpressure(Connection& conn) {
+    if (options_.global_high_water_mark > 0 && !global_throttled_
+        && queued_bytes_ >= options_.global_high_water_mark) {
+        global_throttled_ = true;
+        stats_.global_throttles++;
+        LOG_INFO("发送缓冲区总积压 " << queued_bytes_ << " 字节，超过全局高水位，暂停读取");
+    }
+
+    if (global_throttled_ || conn.send_buffer.above_high_water()) {
+        if (!conn.read_paused) {
+            pause_reading(conn);
+        }
+        return true;
+    }
+    return false;
+}
+
+template <typename Backend, typename Handler>
+void Reactor<Backend, Handler>::pause_reading(Connection& conn) {
+    conn.read_paused = true;
+    stats_.read_pauses++;
+    update_interest(conn);
+}
+
+template <typename Backend, typename Handler>
+void Reactor<Backend, Handler>::resume_reading(Connection& conn) {
+    // 重新注册读事件时内核会检查socket当前状态，边沿触发模式下已经到达的数据也会产生通知
+    conn.read_paused = false;
+    update_interest(conn);
+}
+
+template <typename Backend, typename Handler>
+void Reactor<Backend, Handler>::try_resume(Connection& conn) {
+    // 工作线程池模式下接收缓冲区里可能还积压着请求，回复发得差不多了就先交出去，
+    // 否则客户端不再发送时这些请求没有读事件来推动
+    if (offload() && !conn.task_in_flight && !global_throttled_
+        && conn.send_buffer.size() <= options_.send_low_water_mark) {
+        dispatch_frames(conn);
+    }
+    if (can_resume(conn)) {
+        resume_reading(conn);
+    }
+}
+
+template <typename Backend, typename Handler>
+void Reactor<Backend, Handler>::release_global_throttle() {
+    global_throttled_ = false;
+    LOG_INFO("发送缓冲区总积压降到 " << queued_bytes_ << " 字节，恢复读取");
+
+    // 全局限流期间暂停的连接可能分布在任何位置，这里整体扫一遍；有低水位的滞后，不会频繁发生
+    connections_.for_each([this](Connection& conn) {
+        if (conn.read_paused) {
+            try_resume(conn);
+        }
+    });
+}
+
+template <typename Backend, typename Handler>
+void Reactor<Backend, Handler>::arm_stall_timer(Connection& conn) {
+    // 发送停滞检测：定时器到期时再检查是否有进展，有进展就顺延，不随每次写事件重新设置
+    if (options_.write_stall_timeout_ms > 0 && conn.stall_timer == TimerWheel::INVALID_TIMER) {
+        uint64_t token = conn.token();
+        conn.stall_timer = timers_.schedule(options_.write_stall_timeout_ms,
+                                            [this, token]() { on_stall_timer(token); });
+    }
+}
+
+template <typename Backend, typename Handler>
+void Reactor<Backend, Handler>::on_idle_timer(uint64_t token) {
+    Connection* conn = connections_.find_token(token);
+    if (conn == nullptr) {
+        return;
+    }
+    conn->idle_timer = TimerWheel::INVALID_TIMER;
+
+    // 收发数据时只更新时间戳，到期时发现期间有活动就按剩余时间重新设置
+    uint64_t idle = now_ms_ - conn->last_active_ms;
+    if (idle < options_.idle_timeout_ms) {
+        conn->idle_timer = timers_.schedule(options_.idle_timeout_ms - idle,
+                                            [this, token]() { on_idle_timer(token); });
+        return;
+    }
+
+    LOG_INFO("客户端 " << conn->fd << " 空闲超时");
+    stats_.idle_closes++;
+    close_connection(*conn);
+}
+
+template <typename Backend, typename Handler>
+void Reactor<Backend, Handler>::on_stall_timer(uint64_t token) {
+    Connection* conn = connections_.find_token(token);
+    if (conn == nullptr) {
+        return;
+    }
+    conn->stall_timer = TimerWheel::INVALID_TIMER;
+
+    // 数据已经发完，不再等待可写事件
+    if (!conn->write_armed) {
+        return;
+    }
+
+    uint64_t stalled = now_ms_ - conn->last_write_ms;
+    if (stalled < options_.write_stall_timeout_ms) {
+        conn->stall_timer = timers_.schedule(options_.write_stall_timeout_ms - stalled,
+                                             [this, token]() { on_stall_timer(token); });
+        return;
+    }
+
+    LOG_WARN("客户端 " << conn->fd << " 发送超时，" << conn->send_buffer.size() << " 字节未发出");
+    stats_.stall_closes++;
+    close_connection(*conn);
+}
+
+template <typename Backend, typename Handler>
+void Reactor<Backend, Handler>::close_connection(Connection& conn) {
+    int client_fd = conn.fd;
+    LOG_DEBUG("关闭连接 " << format_address(conn.addr) << " (fd: " << client_fd << ")");
+
+    timers_.cancel(conn.idle_timer);
+    timers_.cancel(conn.stall_timer);
+    handler_.on_close(conn);
+    queued_bytes_ -= conn.send_buffer.size();
+    close_pipe(conn);
+    connections_.destroy(&conn);
+    stats_.closed_connections++;
+
+    backend_.release(client_fd);
+    close(client_fd);
+
+    // 积压来自已经断开的慢连接时，被全局限流暂停的其他连接发送缓冲区是空的，不会有写事件来解除限流
+    if (global_throttled_ && queued_bytes_ <= options_.global_low_water_mark) {
+        release_global_throttle();
+    }
+}
+
+#endif // REACTOR_H
@@ -1,62 +1,37 @@
 #ifndef REACTOR_ECHO_SERVER_H
 #define REACTOR_ECHO_SERVER_H
 
-#include <sys/select.h>
-#include <sys/socket.h>
-#include <netinet/in.h>
-#include <arpa/inet.h>
-#include <unistd.h>
-#include <fcntl.h>
-#include <errno.h>
-
 #include <iostream>
 #include <string>
-#include <vector>
-#include <map>
-#include <functional>
-#include <memory>
-#include <cstring>
-#include <algorithm>
 
+#include "reactor.h"
+#include "echo_handler.h"
+
+// 单线程Echo服务器
+// 使用epoll后端(水平触发)：每次唤醒只处理内核就绪列表中的fd，不受FD_SETSIZE限制，
+// 等待和分发的开销与就绪连接数成正比，与总连接数无关。
 class ReactorEchoServer {
 public:
-    ReactorEchoServer(const std::string& host = "localhost", int port = 8888);
+    // metrics_endpoint非空时在该端点(TCP端口号或Unix域socket路径)导出Prometheus格式的统计
+    ReactorEchoServer(const std::string& host = "localhost", int port = 8888,
+                      const std::string& metrics_endpoint = "");
     ~ReactorEchoServer();
     
     void start();
+    // 可以在信号处理函数中调用
     void stop();
+    void shutdown(uint64_t drain_timeout_ms) { reactor_.shutdown(drain_timeout_ms); }
+
+    // 可以在其他线程中调用
+    ReactorStats stats() const { return reactor_.stats(); }
+    std::string metrics() const;
+
+    // 默认运行参数，load_gen用它让SelectBackend在相同参数下做对比
+    static ReactorOptions default_options();
 
 private:
-    struct ClientData {
-        int fd;
-        sockaddr_in addr;
-        std::string recv_buffer;
-        std::string send_buffer;
-        bool waiting_for_write;
-        
-        ClientData(int socket_fd, const sockaddr_in& client_addr) 
-            : fd(socket_fd), addr(client_addr), waiting_for_write(false) {}
-    };
-    
-    void setup_server_socket();
-    void event_loop();
-    void handle_accept();
-    void handle_read(int client_fd);
-    void handle_write(int client_fd);
-    void close_connection(int client_fd);
-    void set_non_blocking(int fd);
-    
-    std::string host_;
-    int port_;
-    int server_fd_;
-    bool running_;
-    fd_set read_fds_;
-    fd_set write_fds_;
-    fd_set master_read_fds_;
-    fd_set master_write_fds_;
-    int max_fd_;
-    
-    std::map<int, std::shared_ptr<ClientData>> clients_;
+    Reactor<EpollBackend, EchoHandler> reactor_;
+    std::string metrics_endpoint_;
 };
 
 #endif // REACTOR_ECHO_SERVER_H
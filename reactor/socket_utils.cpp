@@ -0,0 +1,352 @@
+#include "socket_utils.h"
+
+#include <sys/un.h>
+#include <sys/stat.h>
+#include <netinet/tcp.h>
+#include <netdb.h>
+
+#include <cstring>
+
+static sockaddr_un unix_address(const std::string& path);
+
+SocketAddress::SocketAddress() : len_(sizeof(storage_)) {
+    memset(&storage_, 0, sizeof(storage_));
+}
+
+SocketAddress SocketAddress::resolve(const std::string& host, int port) {
+    SocketAddress result;
+
+    if (host.compare(0, 5, "unix:") == 0 || (!host.empty() && host[0] == '/')) {
+        sockaddr_un addr = unix_address(host[0] == '/' ? host : host.substr(5));
+        memcpy(&result.storage_, &addr, sizeof(addr));
+        result.len_ = sizeof(addr);
+        return result;
+    }
+
+    if (host.empty() || host == "*") {
+        sockaddr_in* addr = (sockaddr_in*)&result.storage_;
+        addr->sin_family = AF_INET;
+        addr->sin_addr.s_addr = htonl(INADDR_ANY);
+        addr->sin_port = htons(port);
+        result.len_ = sizeof(sockaddr_in);
+        return result;
+    }
+
+    std::string name = host;
+    if (name.size() > 2 && name.front() == '[' && name.back() == ']') {
+        name = name.substr(1, name.size() - 2);
+    }
+
+    // 字面量直接由getaddrinfo转换，不会查询DNS
+    addrinfo hints;
+    memset(&hints, 0, sizeof(hints));
+    hints.ai_family = AF_UNSPEC;
+    hints.ai_socktype = SOCK_STREAM;
+    hints.ai_flags = AI_NUMERICSERV;
+    addrinfo* list = nullptr;
+    int err = getaddrinfo(name.c_str(), std::to_string(port).c_str(), &hints, &list);
+    if (err != 0) {
+        throw std::runtime_error("Failed to resolve " + host + ": " + gai_strerror(err));
+    }
+    memcpy(&result.storage_, list->ai_addr, list->ai_addrlen);
+    result.len_ = list->ai_addrlen;
+    freeaddrinfo(list);
+    return result;
+}
+
+std::string SocketAddress::to_string() const {
+    switch (family()) {
+    case AF_INET: {
+        const sockaddr_in* addr = (const sockaddr_in*)&storage_;
+        char ip[INET_ADDRSTRLEN];
+        inet_ntop(AF_INET, &addr->sin_addr, ip, sizeof(ip));
+        return std::string(ip) + ":" + std::to_string(ntohs(addr->sin_port));
+    }
+    case AF_INET6: {
+        const sockaddr_in6* addr = (const sockaddr_in6*)&storage_;
+        char ip[INET6_ADDRSTRLEN];
+        inet_ntop(AF_INET6, &addr->sin6_addr, ip, sizeof(ip));
+        return "[" + std::string(ip) + "]:" + std::to_string(ntohs(addr->sin6_port));
+    }
+    case AF_UNIX: {
+        // accept得到的客户端地址通常是未命名的
+        const sockaddr_un* addr = (const sockaddr_un*)&storage_;
+        size_t path_len = len_ > offsetof(sockaddr_un, sun_path) ? len_ - offsetof(sockaddr_un, sun_path) : 0;
+        return "unix:" + std::string(addr->sun_path, strnlen(addr->sun_path, path_len));
+    }
+    default:
+        return "unknown";
+    }
+}
+
+void set_non_blocking(int fd) {
+    int flags = fcntl(fd, F_GETFL, 0);
+    if (flags == -1) {
+        throw std::runtime_error("fcntl F_GETFL failed");
+    }
+    
+    if (fcntl(fd, F_SETFL, flags | O_NONBLOCK) == -1) {
+        throw std::runtime_error("fcntl F_SETFL failed");
+    }
+}
+
+TcpProfile TcpProfile::preset(const std::string& name) {
+    TcpProfile profile;
+    if (name == "default") {
+        return profile;
+    }
+    if (name == "latency") {
+        // 小回复立即发出、立即确认；多块回复用MSG_MORE拼包，不引入额外延迟
+        profile.no_delay = true;
+        profile.quick_ack = true;
+        profile.batching = ReplyBatching::MSG_MORE;
+        return profile;
+    }
+    if (name == "throughput") {
+        // 大缓冲区让单个连接的窗口更大，TCP_CORK把回复凑成满MSS的报文；保留Nagle算法，
+        // 小块回复由内核合并，报文数最少，代价是流水线上的小回复可能多等一个往返
+        profile.send_buffer = 4 * 1024 * 1024;
+        profile.recv_buffer = 4 * 1024 * 1024;
+        profile.batching = ReplyBatching::CORK;
+        return profile;
+    }
+    throw std::runtime_error("unknown tcp profile: " + name);
+}
+
+static void set_int_option(int fd, int level, int name, int value, const char* what) {
+    if (setsockopt(fd, level, name, &value, sizeof(value)) < 0) {
+        throw std::runtime_error(std::string("setsockopt ") + what + " failed: " + strerror(errno));
+    }
+}
+
+void apply_listen_profile(int fd, const TcpProfile& profile) {
+    if (profile.send_buffer > 0) {
+        set_int_option(fd, SOL_SOCKET, SO_SNDBUF, profile.send_buffer, "SO_SNDBUF");
+    }
+    if (profile.recv_buffer > 0) {
+        set_int_option(fd, SOL_SOCKET, SO_RCVBUF, profile.recv_buffer, "SO_RCVBUF");
+    }
+    if (profile.defer_accept_s > 0) {
+        // 监听socket可能是从旧进程接管来的，按实际的地址族判断
+        sockaddr_storage addr;
+        socklen_t len = sizeof(addr);
+        if (getsockname(fd, (sockaddr*)&addr, &len) == 0 && addr.ss_family == AF_UNIX) {
+            return;
+        }
+        set_int_option(fd, IPPROTO_TCP, TCP_DEFER_ACCEPT, profile.defer_accept_s, "TCP_DEFER_ACCEPT");
+    }
+}
+
+void apply_connection_profile(int fd, const TcpProfile& profile) {
+    int opt = 1;
+    if (profile.no_delay) {
+        setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &opt, sizeof(opt));
+    }
+    if (profile.quick_ack) {
+        setsockopt(fd, IPPROTO_TCP, TCP_QUICKACK, &opt, sizeof(opt));
+    }
+}
+
+void set_cork(int fd, bool on) {
+    int opt = on ? 1 : 0;
+    setsockopt(fd, IPPROTO_TCP, TCP_CORK, &opt, sizeof(opt));
+}
+
+// 绑定Unix域socket之前清理上一次运行留下的socket文件。只删除确实是socket、并且没有进程在上面监听的文件：
+// 路径写错时不会误删普通文件，同一路径上启动第二个实例也不会抢走正在运行的服务器的地址
+static void remove_stale_unix_socket(const sockaddr_un* addr, socklen_t len) {
+    const char* path = addr->sun_path;
+    if (path[0] == '\0') {
+        // 抽象命名空间没有文件
+        return;
+    }
+
+    struct stat st;
+    if (lstat(path, &st) == -1) {
+        if (errno == ENOENT) {
+            return;
+        }
+        throw std::runtime_error(std::string("Failed to stat ") + path + ": " + strerror(errno));
+    }
+    if (!S_ISSOCK(st.st_mode)) {
+        throw std::runtime_error(std::string("Address in use: ") + path + " exists and is not a socket");
+    }
+
+    // 非阻塞连接：有进程监听时立即成功，队列满时返回EAGAIN，都说明地址正在使用
+    int fd = socket(AF_UNIX, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+    if (fd == -1) {
+        throw std::runtime_error("Failed to create unix socket");
+    }
+    int err = connect(fd, (const sockaddr*)addr, len) == 0 ? 0 : errno;
+    close(fd);
+    if (err == ECONNREFUSED) {
+        unlink(path);
+    } else if (err == 0 || err == EAGAIN) {
+        throw std::runtime_error(std::string("Address in use: ") + path + " is served by another process");
+    } else if (err != ENOENT) {
+        throw std::runtime_error(std::string("Address in use: ") + path + ": " + strerror(err));
+    }
+}
+
+int create_listen_socket(const SocketAddress& addr, bool reuse_port, int backlog) {
+    // 创建服务器socket，创建时直接设为非阻塞，省掉两次fcntl
+    int server_fd = socket(addr.family(), SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+    if (server_fd == -1) {
+        throw std::runtime_error("Failed to create socket");
+    }
+    
+    if (addr.is_unix()) {
+        // 上一次运行留下的socket文件会让bind失败
+        try {
+            remove_stale_unix_socket((const sockaddr_un*)addr.data(), addr.size());
+        } catch (...) {
+            close(server_fd);
+            throw;
+        }
+    } else {
+        // 设置socket选项
+        int opt = 1;
+        if (setsockopt(server_fd, SOL_SOCKET, SO_REUSEADDR, &opt, sizeof(opt)) < 0) {
+            close(server_fd);
+            throw std::runtime_error("setsockopt failed");
+        }
+        
+        // 多reactor模式下每个线程绑定同一端口，由内核按连接做负载均衡
+        if (reuse_port &&
+            setsockopt(server_fd, SOL_SOCKET, SO_REUSEPORT, &opt, sizeof(opt)) < 0) {
+            close(server_fd);
+            throw std::runtime_error("setsockopt SO_REUSEPORT failed");
+        }
+    }
+    
+    // 绑定地址
+    if (bind(server_fd, addr.data(), addr.size()) < 0) {
+        int err = errno;
+        close(server_fd);
+        throw std::runtime_error("Bind " + addr.to_string() + " failed: " + strerror(err));
+    }
+    
+    // 监听
+    if (listen(server_fd, backlog) < 0) {
+        close(server_fd);
+        throw std::runtime_error("Listen failed");
+    }
+    
+    return server_fd;
+}
+
+int create_listen_socket(const std::string& host, int port, bool reuse_port, int backlog) {
+    return create_listen_socket(SocketAddress::resolve(host, port), reuse_port, backlog);
+}
+
+static sockaddr_un unix_address(const std::string& path) {
+    sockaddr_un addr;
+    memset(&addr, 0, sizeof(addr));
+    addr.sun_family = AF_UNIX;
+    if (path.size() >= sizeof(addr.sun_path)) {
+        throw std::runtime_error("Unix socket path too long: " + path);
+    }
+    memcpy(addr.sun_path, path.c_str(), path.size());
+    return addr;
+}
+
+int create_unix_listen_socket(const std::string& path) {
+    sockaddr_un addr = unix_address(path);
+
+    int fd = socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+    if (fd == -1) {
+        throw std::runtime_error("Failed to create unix socket");
+    }
+
+    try {
+        remove_stale_unix_socket(&addr, sizeof(addr));
+    } catch (...) {
+        close(fd);
+        throw;
+    }
+    if (bind(fd, (sockaddr*)&addr, sizeof(addr)) < 0 || listen(fd, 1) < 0) {
+        close(fd);
+        throw std::runtime_error("Failed to listen on " + path + ": " + strerror(errno));
+    }
+    return fd;
+}
+
+int connect_unix_socket(const std::string& path) {
+    sockaddr_un addr = unix_address(path);
+
+    int fd = socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+    if (fd == -1) {
+        throw std::runtime_error("Failed to create unix socket");
+    }
+
+    if (connect(fd, (sockaddr*)&addr, sizeof(addr)) < 0) {
+        close(fd);
+        throw std::runtime_error("Failed to connect to " + path + ": " + strerror(errno));
+    }
+    return fd;
+}
+
+// 一次最多传递的fd数，每个事件循环一个监听socket
+static const size_t MAX_PASSED_FDS = 64;
+
+void send_fds(int sock, const std::vector<int>& fds) {
+    if (fds.empty() || fds.size() > MAX_PASSED_FDS) {
+        throw std::runtime_error("send_fds: invalid fd count");
+    }
+
+    // 正文只有一个字节的fd个数，fd本身放在控制消息里
+    uint8_t count = (uint8_t)fds.size();
+    iovec iov = {&count, sizeof(count)};
+
+    std::vector<char> control(CMSG_SPACE(sizeof(int) * fds.size()), 0);
+    msghdr msg;
+    memset(&msg, 0, sizeof(msg));
+    msg.msg_iov = &iov;
+    msg.msg_iovlen = 1;
+    msg.msg_control = control.data();
+    msg.msg_controllen = control.size();
+
+    cmsghdr* cmsg = CMSG_FIRSTHDR(&msg);
+    cmsg->cmsg_level = SOL_SOCKET;
+    cmsg->cmsg_type = SCM_RIGHTS;
+    cmsg->cmsg_len = CMSG_LEN(sizeof(int) * fds.size());
+    memcpy(CMSG_DATA(cmsg), fds.data(), sizeof(int) * fds.size());
+
+    if (sendmsg(sock, &msg, MSG_NOSIGNAL) != (ssize_t)sizeof(count)) {
+        throw std::runtime_error(std::string("sendmsg SCM_RIGHTS failed: ") + strerror(errno));
+    }
+}
+
+std::vector<int> recv_fds(int sock) {
+    uint8_t count = 0;
+    iovec iov = {&count, sizeof(count)};
+
+    std::vector<char> control(CMSG_SPACE(sizeof(int) * MAX_PASSED_FDS), 0);
+    msghdr msg;
+    memset(&msg, 0, sizeof(msg));
+    msg.msg_iov = &iov;
+    msg.msg_iovlen = 1;
+    msg.msg_control = control.data();
+    msg.msg_controllen = control.size();
+
+    if (recvmsg(sock, &msg, MSG_CMSG_CLOEXEC) != (ssize_t)sizeof(count)) {
+        throw std::runtime_error(std::string("recvmsg SCM_RIGHTS failed: ") + strerror(errno));
+    }
+
+    std::vector<int> fds;
+    for (cmsghdr* cmsg = CMSG_FIRSTHDR(&msg); cmsg; cmsg = CMSG_NXTHDR(&msg, cmsg)) {
+        if (cmsg->cmsg_level == SOL_SOCKET && cmsg->cmsg_type == SCM_RIGHTS) {
+            size_t n = (cmsg->cmsg_len - CMSG_LEN(0)) / sizeof(int);
+            fds.resize(n);
+            memcpy(fds.data(), CMSG_DATA(cmsg), sizeof(int) * n);
+        }
+    }
+    if (fds.size() != count || (msg.msg_flags & MSG_CTRUNC)) {
+        for (int fd : fds) {
+            close(fd);
+        }
+        throw std::runtime_error("recvmsg SCM_RIGHTS: fd count mismatch");
+    }
+    return fds;
+}
+
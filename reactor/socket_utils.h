@@ -0,0 +1,95 @@
+#ifndef SOCKET_UTILS_H
+#define SOCKET_UTILS_H
+
+#include <sys/socket.h>
+#include <netinet/in.h>
+#include <arpa/inet.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <errno.h>
+
+#include <string>
+#include <vector>
+#include <stdexcept>
+
+// 流式socket地址：AF_INET、AF_INET6或AF_UNIX
+class SocketAddress {
+public:
+    SocketAddress();
+
+    // 解析监听或连接地址，失败时抛出异常
+    //   "unix:/path" 或以'/'开头    Unix域socket，忽略port；同机的边车进程不经过TCP协议栈，延迟更低
+    //   "" 或 "*"                   所有IPv4地址(INADDR_ANY)
+    //   IPv4/IPv6字面量或主机名      IPv6可以写成"[::1]"；主机名取getaddrinfo的第一个结果
+    static SocketAddress resolve(const std::string& host, int port);
+
+    int family() const { return storage_.ss_family; }
+    bool is_unix() const { return family() == AF_UNIX; }
+
+    const sockaddr* data() const { return (const sockaddr*)&storage_; }
+    socklen_t size() const { return len_; }
+    // accept/getpeername的输出参数，len_初始为整个缓冲区的大小
+    sockaddr* data() { return (sockaddr*)&storage_; }
+    socklen_t* size_ptr() { return &len_; }
+
+    // 用于日志输出，例如 127.0.0.1:8888、[::1]:8888、unix:/tmp/echo.sock
+    std::string to_string() const;
+
+private:
+    sockaddr_storage storage_;
+    socklen_t len_;
+};
+
+// 回复的批量发送方式，只影响TCP连接上一次要发出多个数据块的情况
+enum class ReplyBatching {
+    NONE,       // 每个数据块单独send，TCP_NODELAY下各自成为一个报文
+    MSG_MORE,   // 后面还有数据块时带MSG_MORE，内核拼成满MSS的报文，最后一块不带，立即推出；不增加系统调用
+    CORK,       // 发送多个数据块前设置TCP_CORK，发完后取消，每次多两次setsockopt
+};
+
+// 连接级socket参数，监听时和accept后应用；Unix域socket只使用缓冲区大小
+// 内核默认(全部关闭)下小回复受Nagle算法和对端延迟ACK影响，可能等待几十毫秒才发出
+struct TcpProfile {
+    bool no_delay = false;      // TCP_NODELAY：关闭Nagle算法，小回复立即发出
+    bool quick_ack = false;     // TCP_QUICKACK：accept后立即ACK收到的数据，内核过一段时间会自动退回延迟ACK
+    int defer_accept_s = 0;     // TCP_DEFER_ACCEPT：连接上有数据才通知accept，单位秒；服务器先发欢迎消息的协议不要开启
+    int send_buffer = 0;        // SO_SNDBUF字节数，0表示保持内核的自动调节
+    int recv_buffer = 0;        // SO_RCVBUF字节数，设置在监听socket上，连接继承，窗口扩大因子据此协商
+    ReplyBatching batching = ReplyBatching::NONE;
+
+    // 预设：default(内核默认)、latency(低延迟)、throughput(高吞吐)，未知名称抛出异常
+    static TcpProfile preset(const std::string& name);
+};
+
+// 把fd设置为非阻塞模式，失败时抛出异常
+void set_non_blocking(int fd);
+
+// 监听socket上的参数：缓冲区大小和TCP_DEFER_ACCEPT(仅TCP)，失败时抛出异常
+void apply_listen_profile(int fd, const TcpProfile& profile);
+// accept得到的TCP连接上的参数：TCP_NODELAY和TCP_QUICKACK，失败时忽略，连接照常使用
+void apply_connection_profile(int fd, const TcpProfile& profile);
+// 设置或取消TCP_CORK
+void set_cork(int fd, bool on);
+
+// 创建、绑定并监听服务器socket，返回非阻塞的监听fd，失败时抛出异常
+// backlog是等待accept的连接队列长度，TCP下内核会截断到net.core.somaxconn
+// Unix域socket不支持reuse_port(调用者应共享同一个监听socket)；路径上已有的socket文件只在没有进程监听时删除，
+// 路径是普通文件或者有服务器在监听时抛出"Address in use"异常
+int create_listen_socket(const SocketAddress& addr, bool reuse_port = false, int backlog = SOMAXCONN);
+int create_listen_socket(const std::string& host, int port, bool reuse_port = false,
+                         int backlog = SOMAXCONN);
+
+// 进程间交接监听socket用的Unix域socket，失败时抛出异常
+// 监听path(已存在的socket文件按create_listen_socket的规则处理)，返回阻塞的监听fd
+int create_unix_listen_socket(const std::string& path);
+// 连接到path，返回阻塞的fd
+int connect_unix_socket(const std::string& path);
+
+// 通过Unix域socket用SCM_RIGHTS传递一组fd，接收方得到指向同一打开文件的新fd
+void send_fds(int sock, const std::vector<int>& fds);
+std::vector<int> recv_fds(int sock);
+
+// 格式化对端地址，用于日志输出
+inline std::string format_address(const SocketAddress& addr) { return addr.to_string(); }
+
+#endif // SOCKET_UTILS_H
@@ -0,0 +1,216 @@
+#include "timer_wheel.h"
+
+#include <time.h>
+
+#include <climits>
+#include <utility>
+
+TimerWheel::TimerWheel(uint64_t tick_ms)
+    : tick_ms_(tick_ms == 0 ? 1 : tick_ms), current_tick_(0), current_ms_(0), started_(false), size_(0) {
+    for (int i = 0; i < LEVELS * SLOTS; i++) {
+        heads_[i] = -1;
+    }
+    for (int i = 0; i < LEVELS; i++) {
+        occupied_[i] = 0;
+    }
+}
+
+uint64_t TimerWheel::now_ms() {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000 + ts.tv_nsec / 1000000;
+}
+
+TimerWheel::TimerId TimerWheel::schedule(uint64_t delay_ms, Callback cb) {
+    int32_t index;
+    if (!free_nodes_.empty()) {
+        index = free_nodes_.back();
+        free_nodes_.pop_back();
+    } else {
+        index = (int32_t)nodes_.size();
+        nodes_.push_back(Node{Callback(), 0, 0, -1, -1, -1});
+    }
+
+    // 向上取整到tick，并且至少在下一个tick才触发，当前tick的槽位已经处理过了
+    uint64_t expire = (current_ms_ + delay_ms + tick_ms_ - 1) / tick_ms_;
+    if (expire <= current_tick_) {
+        expire = current_tick_ + 1;
+    }
+    // 超出时间轮范围的按最远的槽位处理
+    if (expire - current_tick_ >= MAX_TICKS) {
+        expire = current_tick_ + MAX_TICKS - 1;
+    }
+
+    Node& node = nodes_[index];
+    node.cb = std::move(cb);
+    node.expire_tick = expire;
+    node.generation++;
+    if (node.generation == 0) {
+        node.generation = 1;
+    }
+    place(index);
+    size_++;
+
+    return ((uint64_t)node.generation << 32) | (uint32_t)index;
+}
+
+bool TimerWheel::cancel(TimerId id) {
+    uint32_t index = (uint32_t)id;
+    uint32_t generation = (uint32_t)(id >> 32);
+    if (index >= nodes_.size()) {
+        return false;
+    }
+
+    Node& node = nodes_[index];
+    if (node.generation != generation || node.bucket < 0) {
+        return false;
+    }
+
+    unlink(index);
+    release(index);
+    return true;
+}
+
+void TimerWheel::place(int32_t index) {
+    Node& node = nodes_[index];
+    uint64_t delta = node.expire_tick - current_tick_;
+
+    // 找到能容纳delta的最低一层
+    int level = 0;
+    while (level < LEVELS - 1 && delta >= ((uint64_t)1 << ((level + 1) * SLOT_BITS))) {
+        level++;
+    }
+    int slot = (int)((node.expire_tick >> (level * SLOT_BITS)) & SLOT_MASK);
+    int bucket = level * SLOTS + slot;
+
+    // 插到槽位链表头部
+    node.bucket = bucket;
+    node.prev = -1;
+    node.next = heads_[bucket];
+    if (node.next != -1) {
+        nodes_[node.next].prev = index;
+    }
+    heads_[bucket] = index;
+    occupied_[level] |= (uint64_t)1 << slot;
+}
+
+void TimerWheel::unlink(int32_t index) {
+    Node& node = nodes_[index];
+    int bucket = node.bucket;
+
+    if (node.prev != -1) {
+        nodes_[node.prev].next = node.next;
+    } else {
+        heads_[bucket] = node.next;
+    }
+    if (node.next != -1) {
+        nodes_[node.next].prev = node.prev;
+    }
+
+    if (heads_[bucket] == -1) {
+        occupied_[bucket / SLOTS] &= ~((uint64_t)1 << (bucket % SLOTS));
+    }
+    node.bucket = -1;
+    node.prev = -1;
+    node.next = -1;
+}
+
+void TimerWheel::release(int32_t index) {
+    nodes_[index].cb = nullptr;
+    free_nodes_.push_back(index);
+    size_--;
+}
+
+void TimerWheel::cascade(int level) {
+    int slot = (int)((current_tick_ >> (level * SLOT_BITS)) & SLOT_MASK);
+    int bucket = level * SLOTS + slot;
+
+    // 这个槽位里的定时器都在未来64^level个tick内到期，重新分配到下层
+    while (heads_[bucket] != -1) {
+        int32_t index = heads_[bucket];
+        unlink(index);
+        place(index);
+    }
+}
+
+size_t TimerWheel::tick() {
+    current_tick_++;
+
+    // 低层转完一圈时依次从高层补充
+    for (int level = 1; level < LEVELS; level++) {
+        if ((current_tick_ & (((uint64_t)1 << (level * SLOT_BITS)) - 1)) != 0) {
+            break;
+        }
+        cascade(level);
+    }
+
+    size_t fired = 0;
+    int bucket = (int)(current_tick_ & SLOT_MASK);
+    while (heads_[bucket] != -1) {
+        int32_t index = heads_[bucket];
+        unlink(index);
+
+        // 先把回调移出来再释放节点，回调里可能添加定时器导致nodes_扩容
+        Callback cb = std::move(nodes_[index].cb);
+        release(index);
+        cb();
+        fired++;
+    }
+    return fired;
+}
+
+size_t TimerWheel::advance(uint64_t now_ms) {
+    if (!started_) {
+        started_ = true;
+        current_ms_ = now_ms;
+        current_tick_ = now_ms / tick_ms_;
+        return 0;
+    }
+    if (now_ms < current_ms_) {
+        return 0;
+    }
+    current_ms_ = now_ms;
+
+    uint64_t target = now_ms / tick_ms_;
+    size_t fired = 0;
+    while (current_tick_ < target) {
+        if (size_ == 0) {
+            // 没有定时器，直接跳到目标位置
+            current_tick_ = target;
+            break;
+        }
+        fired += tick();
+    }
+    return fired;
+}
+
+int TimerWheel::next_timeout_ms() const {
+    if (size_ == 0) {
+        return -1;
+    }
+
+    // 每层找当前槽位之后第一个非空槽位，该槽位在对应的tick被处理(第0层触发，其他层下放)
+    uint64_t next_tick = UINT64_MAX;
+    for (int level = 0; level < LEVELS; level++) {
+        uint64_t mask = occupied_[level];
+        if (mask == 0) {
+            continue;
+        }
+        int shift = level * SLOT_BITS;
+        uint64_t position = current_tick_ >> shift;
+        int start = (int)((position + 1) & SLOT_MASK);
+        uint64_t rotated = start == 0 ? mask : ((mask >> start) | (mask << (SLOTS - start)));
+        uint64_t offset = (uint64_t)__builtin_ctzll(rotated) + 1;
+        uint64_t when = (position + offset) << shift;
+        if (when < next_tick) {
+            next_tick = when;
+        }
+    }
+
+    uint64_t when_ms = next_tick * tick_ms_;
+    if (when_ms <= current_ms_) {
+        return 0;
+    }
+    uint64_t wait = when_ms - current_ms_;
+    return wait > (uint64_t)INT_MAX ? INT_MAX : (int)wait;
+}
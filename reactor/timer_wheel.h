@@ -0,0 +1,80 @@
+#ifndef TIMER_WHEEL_H
+#define TIMER_WHEEL_H
+
+#include <cstdint>
+#include <cstddef>
+#include <vector>
+#include <functional>
+
+// 分层时间轮
+// 4层，每层64个槽位，第0层一个槽位是一个tick，第n层一个槽位是64^n个tick；
+// 定时器挂在按到期时间算出的槽位链表上，插入和取消都是O(1)，
+// 第0层转完一圈时把上一层对应槽位里的定时器重新分配到下层。
+// 每层用一个64位位图记录非空槽位，计算下一次到期时间不需要扫描空槽位。
+// 与事件循环在同一线程使用，非线程安全。
+class TimerWheel {
+public:
+    typedef std::function<void()> Callback;
+    // 高32位代数，低32位节点下标；代数从1开始，0永远不是有效的定时器
+    typedef uint64_t TimerId;
+    static const TimerId INVALID_TIMER = 0;
+
+    explicit TimerWheel(uint64_t tick_ms = 10);
+
+    TimerWheel(const TimerWheel&) = delete;
+    TimerWheel& operator=(const TimerWheel&) = delete;
+
+    // delay_ms毫秒后(相对上一次advance的时间)调用cb，至少推迟一个tick
+    TimerId schedule(uint64_t delay_ms, Callback cb);
+    // 取消尚未触发的定时器，已触发或已取消的返回false
+    bool cancel(TimerId id);
+
+    // 把时间轮推进到now_ms，依次调用所有到期的回调，返回触发的个数
+    // 回调中可以安全地添加和取消定时器
+    size_t advance(uint64_t now_ms);
+
+    // 距离下一个需要处理的槽位还有多少毫秒，没有定时器时返回-1
+    int next_timeout_ms() const;
+
+    size_t size() const { return size_; }
+    uint64_t tick_ms() const { return tick_ms_; }
+    uint64_t current_ms() const { return current_ms_; }
+
+    // CLOCK_MONOTONIC毫秒数
+    static uint64_t now_ms();
+
+private:
+    static const int LEVELS = 4;
+    static const int SLOT_BITS = 6;
+    static const int SLOTS = 1 << SLOT_BITS;
+    static const uint64_t SLOT_MASK = SLOTS - 1;
+    static const uint64_t MAX_TICKS = (uint64_t)1 << (LEVELS * SLOT_BITS);
+
+    struct Node {
+        Callback cb;
+        uint64_t expire_tick;
+        uint32_t generation;
+        int32_t prev;
+        int32_t next;
+        int32_t bucket;     // 所在槽位，-1表示空闲
+    };
+
+    void place(int32_t index);
+    void unlink(int32_t index);
+    void release(int32_t index);
+    void cascade(int level);
+    size_t tick();
+
+    uint64_t tick_ms_;
+    uint64_t current_tick_;
+    uint64_t current_ms_;
+    bool started_;
+
+    std::vector<Node> nodes_;
+    std::vector<int32_t> free_nodes_;
+    int32_t heads_[LEVELS * SLOTS];
+    uint64_t occupied_[LEVELS];     // 每层非空槽位的位图
+    size_t size_;
+};
+
+#endif // TIMER_WHEEL_H
@@ -0,0 +1,92 @@
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <stdatomic.h>
+#include <time.h>
+
+#include "tpool.h"
+
+// tiny-task throughput: every work only bumps a counter, so the numbers are
+// the cost of adding, queueing and freeing a work item
+//
+//   gcc -O2 -pthread bench.c tpool.c -o bench
+//   gcc -O2 -pthread -DTPOOL_MALLOC_WORK bench.c tpool.c -o bench_malloc
+//   ./bench [threads] [works]
+
+#define BENCH_BATCH 64
+#define BENCH_SPAWN_FANOUT 64
+
+static atomic_size_t done_cnt;
+static tpool_t* spawn_pool;
+
+static void tiny(void* arg) {
+    (void)arg;
+    atomic_fetch_add_explicit(&done_cnt, 1, memory_order_relaxed);
+}
+
+// runs inside the pool and adds its children from there
+static void spawner(void* arg) {
+    size_t n = (size_t)arg;
+    void* args[BENCH_SPAWN_FANOUT];
+    memset(args, 0, sizeof(args));
+    while (n > 0) {
+        size_t k = n < BENCH_SPAWN_FANOUT ? n : BENCH_SPAWN_FANOUT;
+        tpool_add_work_batch(spawn_pool, tiny, args, k);
+        n -= k;
+    }
+}
+
+static double now_sec(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+static void report(const char* mode, size_t works, double start) {
+    double sec = now_sec() - start;
+    size_t done = atomic_load(&done_cnt);
+    printf("%-8s %10zu works %8.3f s %12.0f works/s%s\n",
+           mode, works, sec, works / sec, done == works ? "" : "  MISSING WORKS");
+}
+
+int main(int argc, char* argv[]) {
+    size_t num_threads = argc > 1 ? strtoul(argv[1], NULL, 10) : 4;
+    size_t num_works = argc > 2 ? strtoul(argv[2], NULL, 10) : 4000000;
+    tpool_t* tm = tpool_create(num_threads);
+    double start;
+
+    // one tpool_add_work per work from the main thread
+    atomic_store(&done_cnt, 0);
+    start = now_sec();
+    for (size_t i = 0; i < num_works; i++) {
+        tpool_add_work(tm, tiny, NULL);
+    }
+    tpool_wait(tm);
+    report("single", num_works, start);
+
+    // BENCH_BATCH works per tpool_add_work_batch from the main thread
+    void* args[BENCH_BATCH];
+    memset(args, 0, sizeof(args));
+    atomic_store(&done_cnt, 0);
+    start = now_sec();
+    for (size_t i = 0; i < num_works; i += BENCH_BATCH) {
+        size_t k = num_works - i < BENCH_BATCH ? num_works - i : BENCH_BATCH;
+        tpool_add_work_batch(tm, tiny, args, k);
+    }
+    tpool_wait(tm);
+    report("batch", num_works, start);
+
+    // one spawner per thread, each adding its share from inside the pool
+    spawn_pool = tm;
+    atomic_store(&done_cnt, 0);
+    start = now_sec();
+    for (size_t i = 0; i < num_threads; i++) {
+        size_t share = num_works / num_threads + (i < num_works % num_threads);
+        tpool_add_work(tm, spawner, (void*)share);
+    }
+    tpool_wait(tm);
+    report("spawn", num_works, start);
+
+    tpool_destroy(tm);
+    return 0;
+}
@@ -1,74 +1,501 @@
 #include "tpool.h"
 
-static tpool_work_t* tpool_work_create(thread_func_t func, void* arg) {
-    if (func == NULL) {
-        return NULL;
+#include <sched.h>
+#include <stdatomic.h>
+#include <stdint.h>
+
+// Work-stealing pool
+//
+// Every worker owns a Chase-Lev deque: the owner pushes and takes at the
+// bottom without locks, idle workers steal from the top of a random victim
+// with one CAS. Works added by threads outside the pool go to a global
+// injection queue guarded by a mutex, which workers only touch when their
+// own deque is empty.
+//
+// Work items are carved from slabs owned by the pool and recycled, not
+// malloc'ed per work: a worker keeps the items it finished in a private
+// cache and trades them with the shared free list in chunks, external
+// submitters take items from the shared list under the injection lock they
+// hold anyway. Build with -DTPOOL_MALLOC_WORK to get the old malloc/free
+// per work back, for comparison.
+//
+// Idle workers park on a condition variable. A submitter of n works wakes
+// at most n parked workers one signal at a time (never a broadcast), and
+// only when somebody is parked, so a busy pool never touches the park mutex.
+
+#define TPOOL_DEQUE_INIT_SIZE 256
+#define TPOOL_SPIN_ROUNDS 16
+#define TPOOL_SLAB_SIZE 256         // work items per slab
+#define TPOOL_CACHE_MAX 512         // a worker's cache beyond this goes back in halves
+#define TPOOL_INJECT_BATCH 32       // max works a worker takes from the injection queue at once
+
+typedef struct tpool_array {
+    size_t size;                        // power of two
+    struct tpool_array* retired;        // older arrays, freed with the deque
+    _Atomic(tpool_work_t*) items[];
+} tpool_array_t;
+
+typedef struct tpool_deque {
+    atomic_long top;
+    atomic_long bottom;
+    _Atomic(tpool_array_t*) array;
+} tpool_deque_t;
+
+typedef struct tpool_slab {
+    struct tpool_slab* next;
+    tpool_work_t items[TPOOL_SLAB_SIZE];
+} tpool_slab_t;
+
+typedef struct tpool_worker {
+    tpool_deque_t deque;
+    struct tpool* pool;
+    size_t index;
+    uint32_t seed;                      // xorshift state for picking victims
+    tpool_work_t* cache;                // free work items, owner only
+    size_t cache_cnt;
+} tpool_worker_t;
+
+struct tpool {
+    tpool_worker_t* workers;
+    size_t thread_cnt;
+
+    // works added from outside the pool, plus the shared free list and the
+    // slabs, all guarded by inject_mutex
+    pthread_mutex_t inject_mutex;
+    tpool_work_t* inject_first;
+    tpool_work_t* inject_last;
+    atomic_size_t inject_cnt;
+    tpool_work_t* free_list;
+    tpool_slab_t* slabs;
+
+    // parked workers, wakeups are handed out one by one
+    pthread_mutex_t park_mutex;
+    pthread_cond_t park_cond;
+    atomic_size_t sleeping;
+    size_t wakeups;
+
+    // tpool_wait/tpool_destroy
+    pthread_mutex_t wait_mutex;
+    pthread_cond_t wait_cond;
+    atomic_size_t pending;              // added but not finished
+    size_t alive;                       // running worker threads
+
+    atomic_bool stop;
+};
+
+// the worker running on this thread, NULL outside of any pool
+static __thread tpool_worker_t* tpool_current = NULL;
+
+static void tpool_notify(tpool_t* tm, size_t n);
+
+// shared free list, inject_mutex held. NULL only when out of memory
+static tpool_work_t* tpool_work_get_locked(tpool_t* tm) {
+#ifdef TPOOL_MALLOC_WORK
+    (void)tm;
+    return (tpool_work_t*)malloc(sizeof(tpool_work_t));
+#else
+    if (tm->free_list == NULL) {
+        tpool_slab_t* slab = (tpool_slab_t*)malloc(sizeof(*slab));
+        if (slab == NULL) {
+            return NULL;
+        }
+        slab->next = tm->slabs;
+        tm->slabs = slab;
+        for (size_t i = 0; i < TPOOL_SLAB_SIZE; i++) {
+            slab->items[i].next = tm->free_list;
+            tm->free_list = &(slab->items[i]);
+        }
     }
-    tpool_work_t* work = NULL;
-
-    work = (tpool_work_t*)malloc(sizeof(*work));
-    work->func = func;
-    work->arg = arg;
-    work->next = NULL;
+    tpool_work_t* work = tm->free_list;
+    tm->free_list = work->next;
+    return work;
+#endif
+}
 
+// owner only: a free item from the worker's cache, refilled from the
+// shared list half a cache at a time
+static tpool_work_t* tpool_work_get(tpool_worker_t* w) {
+#ifdef TPOOL_MALLOC_WORK
+    (void)w;
+    return (tpool_work_t*)malloc(sizeof(tpool_work_t));
+#else
+    if (w->cache == NULL) {
+        tpool_t* tm = w->pool;
+        pthread_mutex_lock(&(tm->inject_mutex));
+        for (size_t i = 0; i < TPOOL_CACHE_MAX / 2; i++) {
+            tpool_work_t* work = tpool_work_get_locked(tm);
+            if (work == NULL) {
+                break;
+            }
+            work->next = w->cache;
+            w->cache = work;
+            w->cache_cnt++;
+        }
+        pthread_mutex_unlock(&(tm->inject_mutex));
+        if (w->cache == NULL) {
+            return NULL;
+        }
+    }
+    tpool_work_t* work = w->cache;
+    w->cache = work->next;
+    w->cache_cnt--;
     return work;
+#endif
+}
+
+// owner only: recycle a finished work into the worker's cache, a full
+// cache gives half of it back to the shared list under one lock
+static void tpool_work_put(tpool_worker_t* w, tpool_work_t* work) {
+#ifdef TPOOL_MALLOC_WORK
+    (void)w;
+    free(work);
+#else
+    work->next = w->cache;
+    w->cache = work;
+    if (++w->cache_cnt <= TPOOL_CACHE_MAX) {
+        return;
+    }
+    tpool_work_t* first = w->cache;
+    tpool_work_t* last = first;
+    for (size_t i = 1; i < TPOOL_CACHE_MAX / 2; i++) {
+        last = last->next;
+    }
+    w->cache = last->next;
+    w->cache_cnt -= TPOOL_CACHE_MAX / 2;
+
+    tpool_t* tm = w->pool;
+    pthread_mutex_lock(&(tm->inject_mutex));
+    last->next = tm->free_list;
+    tm->free_list = first;
+    pthread_mutex_unlock(&(tm->inject_mutex));
+#endif
 }
 
-static void tpool_work_destroy(tpool_work_t* work) {
-    if (work != NULL) {
-        free(work);
-        work = NULL;
+// give back a list of items that never got queued, inject_mutex held
+static void tpool_work_unget_locked(tpool_t* tm, tpool_work_t* first) {
+    while (first) {
+        tpool_work_t* next = first->next;
+#ifdef TPOOL_MALLOC_WORK
+        free(first);
+#else
+        first->next = tm->free_list;
+        tm->free_list = first;
+#endif
+        first = next;
     }
+    (void)tm;
+}
+
+// works dropped by tpool_destroy; with slabs they go away with the slabs
+static void tpool_work_drop(tpool_work_t* work) {
+#ifdef TPOOL_MALLOC_WORK
+    free(work);
+#else
+    (void)work;
+#endif
 }
 
-static tpool_work_t* tpool_work_get(tpool_t* tm) {
-    if (tm == NULL || tm->work_first == NULL) {
+static tpool_array_t* tpool_array_create(size_t size) {
+    tpool_array_t* array = (tpool_array_t*)malloc(sizeof(*array) + size * sizeof(array->items[0]));
+    if (array == NULL) {
         return NULL;
     }
-    tpool_work_t* work = tm->work_first;
-    tm->work_first = work->next;
-    if (work->next == NULL) {
-        tm->work_last  == NULL;
+    array->size = size;
+    array->retired = NULL;
+    return array;
+}
+
+static bool tpool_deque_init(tpool_deque_t* dq) {
+    tpool_array_t* array = tpool_array_create(TPOOL_DEQUE_INIT_SIZE);
+    if (array == NULL) {
+        return false;
     }
+    atomic_init(&dq->top, 0);
+    atomic_init(&dq->bottom, 0);
+    atomic_init(&dq->array, array);
+    return true;
+}
 
-    return work;
+// drop the works left in the deque and free all arrays
+static void tpool_deque_destroy(tpool_deque_t* dq) {
+    tpool_array_t* array = atomic_load_explicit(&dq->array, memory_order_relaxed);
+    long top = atomic_load_explicit(&dq->top, memory_order_relaxed);
+    long bottom = atomic_load_explicit(&dq->bottom, memory_order_relaxed);
+    for (long i = top; i < bottom; i++) {
+        tpool_work_drop(atomic_load_explicit(&array->items[i & (array->size - 1)], memory_order_relaxed));
+    }
+    while (array) {
+        tpool_array_t* retired = array->retired;
+        free(array);
+        array = retired;
+    }
 }
 
-static void* tpool_worker(void* arg) {
-    tpool_t* tm = (tpool_t*)arg;
-    tpool_work_t* work = NULL;
+// owner only: double the array. Thieves may still read the old one, so it
+// is kept on the retired list instead of being freed
+static tpool_array_t* tpool_deque_grow(tpool_deque_t* dq, tpool_array_t* old, long top, long bottom) {
+    tpool_array_t* array = tpool_array_create(old->size * 2);
+    if (array == NULL) {
+        return NULL;
+    }
+    for (long i = top; i < bottom; i++) {
+        tpool_work_t* work = atomic_load_explicit(&old->items[i & (old->size - 1)], memory_order_relaxed);
+        atomic_store_explicit(&array->items[i & (array->size - 1)], work, memory_order_relaxed);
+    }
+    array->retired = old;
+    atomic_store_explicit(&dq->array, array, memory_order_release);
+    return array;
+}
 
-    while (1) {
-        pthread_mutex_lock(&(tm->work_mutex));
+// owner only
+static bool tpool_deque_push(tpool_deque_t* dq, tpool_work_t* work) {
+    long bottom = atomic_load_explicit(&dq->bottom, memory_order_relaxed);
+    long top = atomic_load_explicit(&dq->top, memory_order_acquire);
+    tpool_array_t* array = atomic_load_explicit(&dq->array, memory_order_relaxed);
+    if (bottom - top > (long)array->size - 1) {
+        array = tpool_deque_grow(dq, array, top, bottom);
+        if (array == NULL) {
+            return false;
+        }
+    }
+    atomic_store_explicit(&array->items[bottom & (array->size - 1)], work, memory_order_relaxed);
+    // publishes the work to thieves, they load bottom with acquire
+    atomic_store_explicit(&dq->bottom, bottom + 1, memory_order_release);
+    return true;
+}
+
+// owner only: LIFO end, the most recently pushed work is still hot in cache
+static tpool_work_t* tpool_deque_take(tpool_deque_t* dq) {
+    long bottom = atomic_load_explicit(&dq->bottom, memory_order_relaxed) - 1;
+    tpool_array_t* array = atomic_load_explicit(&dq->array, memory_order_relaxed);
+    atomic_store_explicit(&dq->bottom, bottom, memory_order_relaxed);
+    atomic_thread_fence(memory_order_seq_cst);
+    long top = atomic_load_explicit(&dq->top, memory_order_relaxed);
 
-        while (tm->work_first == NULL && !tm->stop) {
-            pthread_cond_wait(&(tm->work_cond), &(tm->work_mutex));
+    tpool_work_t* work = NULL;
+    if (top <= bottom) {
+        work = atomic_load_explicit(&array->items[bottom & (array->size - 1)], memory_order_relaxed);
+        if (top == bottom) {
+            // last item, race against thieves for it
+            if (!atomic_compare_exchange_strong_explicit(&dq->top, &top, top + 1, memory_order_seq_cst,
+                                                         memory_order_relaxed)) {
+                work = NULL;
+            }
+            atomic_store_explicit(&dq->bottom, bottom + 1, memory_order_relaxed);
         }
+    } else {
+        atomic_store_explicit(&dq->bottom, bottom + 1, memory_order_relaxed);
+    }
+    return work;
+}
 
-        if (tm->stop) {
-            break;
+// any thread: FIFO end. Returns NULL when empty or when another thief won
+static tpool_work_t* tpool_deque_steal(tpool_deque_t* dq) {
+    long top = atomic_load_explicit(&dq->top, memory_order_acquire);
+    atomic_thread_fence(memory_order_seq_cst);
+    long bottom = atomic_load_explicit(&dq->bottom, memory_order_acquire);
+    if (top >= bottom) {
+        return NULL;
+    }
+    tpool_array_t* array = atomic_load_explicit(&dq->array, memory_order_acquire);
+    tpool_work_t* work = atomic_load_explicit(&array->items[top & (array->size - 1)], memory_order_relaxed);
+    if (!atomic_compare_exchange_strong_explicit(&dq->top, &top, top + 1, memory_order_seq_cst,
+                                                 memory_order_relaxed)) {
+        return NULL;
+    }
+    return work;
+}
+
+static bool tpool_deque_empty(tpool_deque_t* dq) {
+    long top = atomic_load_explicit(&dq->top, memory_order_acquire);
+    long bottom = atomic_load_explicit(&dq->bottom, memory_order_acquire);
+    return top >= bottom;
+}
+
+// take a share of the injection queue: the first work is returned, the
+// rest go to the worker's own deque where idle workers can steal them
+static tpool_work_t* tpool_inject_pop(tpool_worker_t* w) {
+    tpool_t* tm = w->pool;
+    // cheap check first, so idle workers don't hammer the mutex
+    size_t cnt = atomic_load_explicit(&tm->inject_cnt, memory_order_acquire);
+    if (cnt == 0) {
+        return NULL;
+    }
+    size_t want = cnt / tm->thread_cnt + 1;
+    if (want > TPOOL_INJECT_BATCH) {
+        want = TPOOL_INJECT_BATCH;
+    }
+
+    tpool_work_t* batch[TPOOL_INJECT_BATCH];
+    size_t taken = 0;
+    pthread_mutex_lock(&(tm->inject_mutex));
+    while (taken < want && tm->inject_first) {
+        tpool_work_t* work = tm->inject_first;
+        tm->inject_first = work->next;
+        batch[taken++] = work;
+    }
+    if (tm->inject_first == NULL) {
+        tm->inject_last = NULL;
+    }
+    atomic_fetch_sub_explicit(&tm->inject_cnt, taken, memory_order_relaxed);
+    pthread_mutex_unlock(&(tm->inject_mutex));
+
+    if (taken == 0) {
+        return NULL;
+    }
+    // pushed newest first, so the owner still takes them in submission order
+    size_t pushed = 0;
+    for (size_t i = taken - 1; i > 0; i--) {
+        if (tpool_deque_push(&(w->deque), batch[i])) {
+            pushed++;
+            continue;
         }
+        // out of memory growing the deque, hand the rest back
+        pthread_mutex_lock(&(tm->inject_mutex));
+        batch[i]->next = tm->inject_first;
+        for (size_t j = i; j > 1; j--) {
+            batch[j - 1]->next = batch[j];
+        }
+        tm->inject_first = batch[1];
+        if (tm->inject_last == NULL) {
+            tm->inject_last = batch[i];
+        }
+        atomic_fetch_add_explicit(&tm->inject_cnt, i, memory_order_release);
+        pthread_mutex_unlock(&(tm->inject_mutex));
+        break;
+    }
+    if (pushed > 0) {
+        tpool_notify(tm, pushed);
+    }
+    return batch[0];
+}
 
-        work = tpool_work_get(tm);
-        tm->working_cnt++;
-        pthread_mutex_unlock(&(tm->work_mutex));
+static uint32_t tpool_random(tpool_worker_t* w) {
+    uint32_t x = w->seed;
+    x ^= x << 13;
+    x ^= x >> 17;
+    x ^= x << 5;
+    w->seed = x;
+    return x;
+}
 
+static tpool_work_t* tpool_steal(tpool_worker_t* w) {
+    tpool_t* tm = w->pool;
+    if (tm->thread_cnt < 2) {
+        return NULL;
+    }
+    // start at a random victim so thieves spread out, then try everybody once
+    size_t start = tpool_random(w) % tm->thread_cnt;
+    for (size_t i = 0; i < tm->thread_cnt; i++) {
+        size_t victim = (start + i) % tm->thread_cnt;
+        if (victim == w->index) {
+            continue;
+        }
+        tpool_work_t* work = tpool_deque_steal(&(tm->workers[victim].deque));
         if (work) {
-            work->func(work->arg);
-            tpool_work_destroy(work);
+            return work;
         }
+    }
+    return NULL;
+}
+
+static tpool_work_t* tpool_find_work(tpool_worker_t* w) {
+    tpool_work_t* work = tpool_deque_take(&(w->deque));
+    if (work == NULL) {
+        work = tpool_inject_pop(w);
+    }
+    if (work == NULL) {
+        work = tpool_steal(w);
+    }
+    return work;
+}
+
+static bool tpool_has_work(tpool_t* tm) {
+    if (atomic_load_explicit(&tm->inject_cnt, memory_order_acquire) != 0) {
+        return true;
+    }
+    for (size_t i = 0; i < tm->thread_cnt; i++) {
+        if (!tpool_deque_empty(&(tm->workers[i].deque))) {
+            return true;
+        }
+    }
+    return false;
+}
+
+// wake up to n parked workers, one signal each. Pairs with the fence in
+// tpool_park: either the submitter sees the sleeper, or the sleeper sees the
+// new work
+static void tpool_notify(tpool_t* tm, size_t n) {
+    atomic_thread_fence(memory_order_seq_cst);
+    if (atomic_load_explicit(&tm->sleeping, memory_order_relaxed) == 0) {
+        return;
+    }
+    pthread_mutex_lock(&(tm->park_mutex));
+    while (n-- > 0 && tm->wakeups < atomic_load_explicit(&tm->sleeping, memory_order_relaxed)) {
+        tm->wakeups++;
+        pthread_cond_signal(&(tm->park_cond));
+    }
+    pthread_mutex_unlock(&(tm->park_mutex));
+}
+
+static void tpool_park(tpool_t* tm) {
+    pthread_mutex_lock(&(tm->park_mutex));
+    atomic_fetch_add_explicit(&tm->sleeping, 1, memory_order_relaxed);
+    atomic_thread_fence(memory_order_seq_cst);
+    // re-check after announcing ourselves, a work added before this point
+    // may not have seen us sleeping
+    if (!tpool_has_work(tm)) {
+        while (tm->wakeups == 0 && !atomic_load(&tm->stop)) {
+            pthread_cond_wait(&(tm->park_cond), &(tm->park_mutex));
+        }
+        if (tm->wakeups > 0) {
+            tm->wakeups--;
+        }
+    }
+    atomic_fetch_sub_explicit(&tm->sleeping, 1, memory_order_relaxed);
+    pthread_mutex_unlock(&(tm->park_mutex));
+}
+
+static void tpool_work_done(tpool_t* tm) {
+    if (atomic_fetch_sub_explicit(&tm->pending, 1, memory_order_acq_rel) == 1) {
+        pthread_mutex_lock(&(tm->wait_mutex));
+        pthread_cond_broadcast(&(tm->wait_cond));
+        pthread_mutex_unlock(&(tm->wait_mutex));
+    }
+}
 
-        pthread_mutex_lock(&(tm->work_mutex));
-        tm->working_cnt--;
-        if (!tm->stop && tm->working_cnt == 0 && tm->work_first == NULL) {
-            pthread_cond_signal(&(tm->working_cond));
+static void* tpool_worker(void* arg) {
+    tpool_worker_t* w = (tpool_worker_t*)arg;
+    tpool_t* tm = w->pool;
+    tpool_work_t* work = NULL;
+
+    tpool_current = w;
+    int idle = 0;
+    while (!atomic_load(&tm->stop)) {
+        work = tpool_find_work(w);
+        if (work == NULL) {
+            // look around a few more times before parking, a steady stream of
+            // works then never pays for the sleep/wakeup round trip
+            if (++idle < TPOOL_SPIN_ROUNDS) {
+                sched_yield();
+                continue;
+            }
+            idle = 0;
+            tpool_park(tm);
+            continue;
         }
-        pthread_mutex_unlock(&(tm->work_mutex));
+        idle = 0;
+
+        work->func(work->arg);
+        tpool_work_put(w, work);
+        tpool_work_done(tm);
     }
+    tpool_current = NULL;
 
-    tm->thread_cnt--;
-    pthread_cond_signal(&(tm->working_cond));
-    pthread_mutex_unlock(&(tm->work_mutex));
+    pthread_mutex_lock(&(tm->wait_mutex));
+    tm->alive--;
+    pthread_cond_broadcast(&(tm->wait_cond));
+    pthread_mutex_unlock(&(tm->wait_mutex));
 
     return NULL;
 }
@@ -82,17 +509,52 @@ tpool_t* tpool_create(size_t num) {
     }
 
     tm = (tpool_t*)calloc(1, sizeof(*tm));
+    if (tm == NULL) {
+        return NULL;
+    }
+    tm->workers = (tpool_worker_t*)calloc(num, sizeof(*tm->workers));
+    if (tm->workers == NULL) {
+        free(tm);
+        return NULL;
+    }
     tm->thread_cnt = num;
-    tm->work_first = NULL;
-    tm->work_last  = NULL;
+    tm->inject_first = NULL;
+    tm->inject_last = NULL;
+    tm->free_list = NULL;
+    tm->slabs = NULL;
+    atomic_init(&tm->inject_cnt, 0);
+    atomic_init(&tm->sleeping, 0);
+    atomic_init(&tm->pending, 0);
+    atomic_init(&tm->stop, false);
 
-    pthread_mutex_init(&(tm->work_mutex), NULL);
-    pthread_cond_init(&(tm->work_cond), NULL);
-    pthread_cond_init(&(tm->working_cond), NULL);
+    for (size_t i = 0; i < num; ++i) {
+        tpool_worker_t* w = &(tm->workers[i]);
+        if (!tpool_deque_init(&(w->deque))) {
+            while (i-- > 0) {
+                tpool_deque_destroy(&(tm->workers[i].deque));
+            }
+            free(tm->workers);
+            free(tm);
+            return NULL;
+        }
+        w->pool = tm;
+        w->index = i;
+        w->seed = (uint32_t)(i * 2654435761u) | 1;
+    }
+
+    pthread_mutex_init(&(tm->inject_mutex), NULL);
+    pthread_mutex_init(&(tm->park_mutex), NULL);
+    pthread_cond_init(&(tm->park_cond), NULL);
+    pthread_mutex_init(&(tm->wait_mutex), NULL);
+    pthread_cond_init(&(tm->wait_cond), NULL);
 
     for (size_t i = 0; i < num; ++i) {
-        pthread_create(&thread, NULL, tpool_worker, tm);
-        pthread_detach(thread);
+        if (pthread_create(&thread, NULL, tpool_worker, &(tm->workers[i])) == 0) {
+            pthread_detach(thread);
+            pthread_mutex_lock(&(tm->wait_mutex));
+            tm->alive++;
+            pthread_mutex_unlock(&(tm->wait_mutex));
+        }
     }
 
     return tm;
@@ -101,65 +563,130 @@ tpool_t* tpool_create(size_t num) {
 void tpool_destroy(tpool_t* tm) {
     if (!tm) return;
 
-    tpool_work_t* work;
-    tpool_work_t* work2;
+    // tell the pool it's time to stop, parked workers all have to see it
+    pthread_mutex_lock(&(tm->park_mutex));
+    atomic_store(&tm->stop, true);
+    pthread_cond_broadcast(&(tm->park_cond));
+    pthread_mutex_unlock(&(tm->park_mutex));
+
+    // waiting the processing threads to finish
+    tpool_wait(tm);
 
-    pthread_mutex_lock(&(tm->work_mutex));
-    // destroy all works
-    work = tm->work_first;
+    // destroy all works nobody picked up, then the slabs holding every item
+    tpool_work_t* work = tm->inject_first;
     while (work) {
-        work2 = work->next;
-        tpool_work_destroy(work);
-        work = work2;
+        tpool_work_t* next = work->next;
+        tpool_work_drop(work);
+        work = next;
+    }
+    for (size_t i = 0; i < tm->thread_cnt; i++) {
+        tpool_deque_destroy(&(tm->workers[i].deque));
+    }
+    while (tm->slabs) {
+        tpool_slab_t* next = tm->slabs->next;
+        free(tm->slabs);
+        tm->slabs = next;
     }
-    tm->work_first = NULL;
-    // tell the pool it's time to stop
-    tm->stop = true;
-    pthread_cond_broadcast(&(tm->work_cond));
-    pthread_mutex_unlock(&(tm->work_mutex));
 
-    // waiting the processing threads to finish
-    tpool_wait(tm);
     // destory all mutex and COND
-    pthread_mutex_destroy(&(tm->work_mutex));
-    pthread_cond_destroy(&(tm->work_cond));
-    pthread_cond_destroy(&(tm->working_cond));
+    pthread_mutex_destroy(&(tm->inject_mutex));
+    pthread_mutex_destroy(&(tm->park_mutex));
+    pthread_cond_destroy(&(tm->park_cond));
+    pthread_mutex_destroy(&(tm->wait_mutex));
+    pthread_cond_destroy(&(tm->wait_cond));
 
+    free(tm->workers);
     free(tm);
 }
 
 void tpool_wait(tpool_t* tm) {
     if (!tm) return;
 
-    pthread_mutex_lock(&(tm->work_mutex));
+    pthread_mutex_lock(&(tm->wait_mutex));
     while (1) {
-        if (tm->work_first != NULL || 
-            (!tm->stop && tm->working_cnt != 0) ||
-            (tm->stop && tm->thread_cnt != 0)) {
-            pthread_cond_wait(&(tm->working_cond), &(tm->work_mutex));
+        bool stop = atomic_load(&tm->stop);
+        if ((!stop && atomic_load(&tm->pending) != 0) ||
+            (stop && tm->alive != 0)) {
+            pthread_cond_wait(&(tm->wait_cond), &(tm->wait_mutex));
         } else {
             break;
         }
     }
-    pthread_mutex_unlock(&(tm->work_mutex));
+    pthread_mutex_unlock(&(tm->wait_mutex));
 }
 
 bool tpool_add_work(tpool_t* tm, thread_func_t func, void* arg) {
-    if (!tm) return false;
+    return tpool_add_work_batch(tm, func, &arg, 1);
+}
 
-    tpool_work_t* work = tpool_work_create(func, arg);
-    if (!work) return false;
+bool tpool_add_work_batch(tpool_t* tm, thread_func_t func, void** args, size_t n) {
+    if (!tm || func == NULL) return false;
+    if (n == 0) return true;
+
+    tpool_worker_t* w = tpool_current;
+    if (w != NULL && w->pool == tm) {
+        // from inside the pool: straight into our own deque, no lock at all
+        size_t i = 0;
+        atomic_fetch_add_explicit(&tm->pending, n, memory_order_relaxed);
+        for (; i < n; i++) {
+            tpool_work_t* work = tpool_work_get(w);
+            if (work == NULL) {
+                break;
+            }
+            work->func = func;
+            work->arg = args[i];
+            work->next = NULL;
+            if (!tpool_deque_push(&(w->deque), work)) {
+                tpool_work_put(w, work);
+                break;
+            }
+        }
+        atomic_fetch_sub_explicit(&tm->pending, n - i, memory_order_relaxed);
+        if (i > 0) {
+            tpool_notify(tm, i);
+        }
+        if (i == n) {
+            return true;
+        }
+        // out of memory, the rest takes the injection queue
+        args += i;
+        n -= i;
+    }
 
-    pthread_mutex_lock(&(tm->work_mutex));
-    if (tm->work_first) {
-        tm->work_last->next = work;
-        tm->work_last = work;
+    // the whole batch is linked and appended under one lock acquisition
+    tpool_work_t* first = NULL;
+    tpool_work_t* last = NULL;
+    pthread_mutex_lock(&(tm->inject_mutex));
+    for (size_t i = 0; i < n; i++) {
+        tpool_work_t* work = tpool_work_get_locked(tm);
+        if (work == NULL) {
+            tpool_work_unget_locked(tm, first);
+            pthread_mutex_unlock(&(tm->inject_mutex));
+            return false;
+        }
+        work->func = func;
+        work->arg = args[i];
+        work->next = NULL;
+        if (last) {
+            last->next = work;
+        } else {
+            first = work;
+        }
+        last = work;
+    }
+
+    atomic_fetch_add_explicit(&tm->pending, n, memory_order_relaxed);
+    if (tm->inject_first) {
+        tm->inject_last->next = first;
+        tm->inject_last = last;
     } else {
-        tm->work_first = work;
-        tm->work_last = tm->work_first;
+        tm->inject_first = first;
+        tm->inject_last = last;
     }
-    pthread_cond_broadcast(&(tm->work_cond));
-    pthread_mutex_unlock(&(tm->work_mutex));
+    atomic_fetch_add_explicit(&tm->inject_cnt, n, memory_order_release);
+    pthread_mutex_unlock(&(tm->inject_mutex));
+
+    tpool_notify(tm, n);
 
     return true;
 }
\ No newline at end of file
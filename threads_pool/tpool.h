@@ -5,6 +5,10 @@
 #include <stdlib.h>
 #include <pthread.h>
 
+#ifdef __cplusplus
+extern "C" {
+#endif
+
 typedef void (*thread_func_t)(void* arg);
 
 typedef struct tpool_work {
@@ -13,27 +17,31 @@ typedef struct tpool_work {
     struct tpool_work* next;
 } tpool_work_t;
 
-typedef struct tpool {
-    tpool_work_t* work_first;
-    tpool_work_t* work_last;
-    pthread_mutex_t work_mutex;
-    pthread_cond_t work_cond;
-    pthread_cond_t working_cond;
-    size_t working_cnt;
-    size_t thread_cnt;
-    bool stop;
-} tpool_t;
+// the pool is opaque: every worker owns a work-stealing deque, works added
+// from outside the pool go through a shared injection queue (see tpool.c)
+typedef struct tpool tpool_t;
 
 // create a threads pool
 tpool_t* tpool_create(size_t num);
-// destroy a threads pool
+// destroy a threads pool, works still queued are dropped
 void tpool_destroy(tpool_t* tm);
 
-// add a work to the queue
+// add a work to the queue; called from a worker of the same pool the work
+// goes to that worker's own deque, otherwise to the injection queue
 bool tpool_add_work(tpool_t* tm, thread_func_t func, void* arg);
 
+// add n works running func(args[i]) with a single lock acquisition, or no
+// lock at all when called from a worker of the same pool; args is not kept.
+// false only when out of memory, a prefix of the batch may be queued then
+bool tpool_add_work_batch(tpool_t* tm, thread_func_t func, void** args, size_t n);
+
+// wait until every added work has finished
 void tpool_wait(tpool_t* tm);
 
+#ifdef __cplusplus
+}
+#endif
+
 
 
 